@@ -47,8 +47,10 @@
 #define CMD_INIT_GET_PI            0x3A
 #define CMD_INIT_SET_ATTRVAL       0x0B
 #define CMD_INIT_GET_ATTRVAL       0x3B
+#define CMD_INIT_SET_ATTRCOUNT     0x0C
 #define CMD_INIT_GET_ATTRCOUNT     0x3C
 #define CMD_INIT_PRECOMPUTE_INPUTS 0x0D
+#define CMD_INIT_STREAM_ATTRVAL    0x0E
 
 #define CMD_ISSUE_PRECOMPUTE    0x11
 #define CMD_ISSUE_SIGMA_A       0x12
@@ -61,8 +63,15 @@
 #define CMD_PRESENT_RETURN_RI        0x23
 #define CMD_PRESENT_RETURN_SIGMAS    0x24
 
+// CMD_PRESENT_RETURN_RI P1 for r_0 and all undisclosed r_i in one response
+#define RETURN_RI_ALL                0xFF
+
 #define CMD_TEST                     0xFF
 
+// Group identifiers, returned by CMD_INIT_GET_PQG with P1 = 3
+#define GROUP_CUSTOM                 0x00  // p, q or g have been set
+#define GROUP_UPROVE_TEST_1024       0x01  // the defaults, from the test vectors
+
 // Status words
 #define ERR_OK                  0x9000
 #define ERR_WRONGCLASS          0x6402
@@ -71,5 +80,7 @@
 #define ERR_WRONGLENGTH         0x6700
 #define ERR_WRONGP1P2           0x6B00
 #define ERR_WRONGSIGNATURE      0x6982
+#define ERR_NOT_ENOUGH_MEMORY   0x6A84
+#define ERR_DATA_NOT_FOUND      0x6A88
 
 #endif // __defs_apdu_H
@@ -0,0 +1,62 @@
+/**
+ * defs_groups.h
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+ 
+#ifndef __defs_groups_H
+#define __defs_groups_H
+
+// The built-in groups as NUMBER_PSIZE/NUMBER_QSIZE initializers, selected
+// by the identifiers in defs_apdu.h
+
+// GROUP_UPROVE_TEST_1024: the 1024-bit group of the test vectors from the
+// U-Prove Cryptographic Specification V1.0
+#define GROUP_UPROVE_TEST_1024_P { \
+    0x00, \
+    0xd2, 0x1a, 0xe8, 0xd6, 0x6e, 0x6c, 0x6b, 0x3c, 0xed, 0x0e, 0xb3, 0xdf, 0x1a, 0x26, 0xc9, 0x1b, \
+    0xde, 0xed, 0x01, 0x3c, 0x17, 0xd8, 0x49, 0xd3, 0x0e, 0xc3, 0x09, 0x81, 0x3e, 0x4d, 0x37, 0x99, \
+    0xf2, 0x6d, 0xb0, 0xd4, 0x94, 0xe8, 0x2e, 0xc6, 0x1e, 0xa9, 0xfd, 0xc7, 0x0b, 0xb5, 0xcb, 0xca, \
+    0xf2, 0xe5, 0xf1, 0x8a, 0x83, 0x64, 0x94, 0xf5, 0x8e, 0x67, 0xc6, 0xd6, 0x16, 0x48, 0x0c, 0x37, \
+    0xa7, 0xf2, 0x30, 0x61, 0x01, 0xfc, 0x9f, 0x0f, 0x47, 0x68, 0xf9, 0xc9, 0x79, 0x3c, 0x2b, 0xe1, \
+    0x76, 0xb0, 0xb7, 0xc9, 0x79, 0xb4, 0x06, 0x5d, 0x3e, 0x83, 0x56, 0x86, 0xa3, 0xf0, 0xb8, 0x42, \
+    0x0c, 0x68, 0x34, 0xcb, 0x17, 0x93, 0x03, 0x86, 0xde, 0xda, 0xb2, 0xb0, 0x7d, 0xd4, 0x73, 0x44, \
+    0x9a, 0x48, 0xba, 0xab, 0x31, 0x62, 0x86, 0xb4, 0x21, 0x05, 0x24, 0x75, 0xd1, 0x34, 0xcd, 0x3b \
+  }
+
+#define GROUP_UPROVE_TEST_1024_Q { \
+    0x00, \
+    0xff, 0xf8, 0x0a, 0xe1, 0x9d, 0xae, 0xbc, 0x61, 0xf4, 0x63, 0x56, 0xaf, 0x09, 0x35, 0xdc, 0x0e, \
+    0x81, 0x14, 0x8e, 0xb1 \
+  }
+
+#define GROUP_UPROVE_TEST_1024_Q_MINUS_2 { \
+    0x00, \
+    0xff, 0xf8, 0x0a, 0xe1, 0x9d, 0xae, 0xbc, 0x61, 0xf4, 0x63, 0x56, 0xaf, 0x09, 0x35, 0xdc, 0x0e, \
+    0x81, 0x14, 0x8e, 0xaf \
+  }
+
+#define GROUP_UPROVE_TEST_1024_G { \
+    0x00, \
+    0xab, 0xce, 0xc9, 0x72, 0xe9, 0xa9, 0xdd, 0x8d, 0x13, 0x32, 0x70, 0xcf, 0xea, 0xc2, 0x6f, 0x72, \
+    0x6e, 0x56, 0x7d, 0x96, 0x47, 0x57, 0x63, 0x0d, 0x6b, 0xd4, 0x34, 0x60, 0xd0, 0x92, 0x3a, 0x46, \
+    0xae, 0xc0, 0xac, 0xe2, 0x55, 0xeb, 0xf3, 0xdd, 0xd4, 0xb1, 0xc4, 0x26, 0x4f, 0x53, 0xe6, 0x8b, \
+    0x36, 0x1a, 0xfb, 0x77, 0x7a, 0x13, 0xcf, 0x00, 0x67, 0xda, 0xe3, 0x64, 0xa3, 0x4d, 0x55, 0xa0, \
+    0x96, 0x5a, 0x6c, 0xcc, 0xf7, 0x88, 0x52, 0x78, 0x29, 0x23, 0x81, 0x3c, 0xf8, 0x70, 0x88, 0x34, \
+    0xd9, 0x1f, 0x65, 0x57, 0xd7, 0x83, 0xec, 0x75, 0xb5, 0xf3, 0x7c, 0xd9, 0x18, 0x5f, 0x02, 0x7b, \
+    0x04, 0x2c, 0x1c, 0x72, 0xe1, 0x21, 0xb1, 0x26, 0x6a, 0x40, 0x8b, 0xe0, 0xbb, 0x72, 0x70, 0xd6, \
+    0x59, 0x17, 0xb6, 0x90, 0x83, 0x63, 0x3e, 0x1f, 0x3c, 0xd6, 0x06, 0x24, 0x61, 0x2f, 0xc8, 0xc1 \
+  }
+
+#endif // __defs_groups_H
@@ -21,10 +21,35 @@
 #define __sizes_H
 
 
-// Attribute definitions
+// Attribute definitions, MAX_ATTR can be set from the Makefile
+#ifndef MAX_ATTR
 #define MAX_ATTR         0x01
+#endif
 #define MAX_ATTR_SIZE    0xFF
 
+#if MAX_ATTR < 1 || MAX_ATTR > 16
+#error MAX_ATTR must be between 1 and 16 (see DEFAULT_PADDING in uprove.c)
+#endif
+
+// Bytes for all attribute values together, ATTR_HEAP can be set from the
+// Makefile; by default 64 per attribute and room for at least one of the
+// largest size
+#ifdef ATTR_HEAP
+#define ATTR_HEAP_SIZE ATTR_HEAP
+#elif MAX_ATTR * 64 > MAX_ATTR_SIZE
+#define ATTR_HEAP_SIZE (MAX_ATTR * 64)
+#else
+#define ATTR_HEAP_SIZE MAX_ATTR_SIZE
+#endif
+
+#if ATTR_HEAP_SIZE < MAX_ATTR_SIZE
+#error ATTR_HEAP must hold at least one attribute of MAX_ATTR_SIZE bytes
+#endif
+
+// attrOffset of an attribute uploaded with CMD_INIT_STREAM_ATTRVAL, only
+// x_i is kept of it
+#define ATTR_STREAMED    0xFFFF
+
 // System parameter lengths
 #define PSIZE_BITS       1024
 #define PSIZE_BYTES      (PSIZE_BITS / 8)
@@ -38,8 +63,27 @@
 #define UID_H_length 5
 #define S_length 31
 
+// P as encoded by computeXt(), for a UID_p of at most 255 bytes
+#define P_ENCODED_SIZE (4 + 255 + 2 * (4 + PSIZE_BYTES) + (4 + QSIZE_BYTES) + \
+                        4 + (MAX_ATTR + 2) * (4 + PSIZE_BYTES) + 4 + MAX_ATTR + 4 + S_length)
+
+#if P_ENCODED_SIZE > 2048
+#define TEMP_SIZE P_ENCODED_SIZE
+#else
 #define TEMP_SIZE 2048
+#endif
+
+// [D] and [f_1,...,f_n] as encoded by generateChallengeC(), all disclosed
+#define F_ENCODED_SIZE (4 + 4 * MAX_ATTR + 4 + (4 + QSIZE_BYTES) * MAX_ATTR)
+
+#if F_ENCODED_SIZE > 256 + 72
+#define TEMP_RAM_SIZE F_ENCODED_SIZE
+#else
+#define TEMP_RAM_SIZE (256 + 72)
+#endif
 
 // Auxiliary sizes
+#define SHA1_BYTES       20
+#define SHA1_BLOCK_BYTES 64
 
 #endif // __sizes_H
@@ -37,9 +37,4 @@ typedef struct {
   unsigned char number[QSIZE_BYTES];
 } NUMBER_QSIZE;
 
-typedef struct {
-  int attr_size;
-  unsigned char attr_val[MAX_ATTR_SIZE];
-} ATTRIBUTE;
-
 #endif // __defs_types_H
@@ -20,10 +20,30 @@
 #ifndef __funcs_debug_H
 #define __funcs_debug_H
 
+/**
+ * Trace levels, set with make TRACE=n:
+ *   0 - nothing (always the case for the smartcard build)
+ *   1 - [CMD], [PRM] and [FUN] events only, for tools/costmodel.py,
+ *       benchmark.py and tracedump.py
+ *   2 - events plus messages and intermediate values (default)
+ */
 #ifdef SIMULATOR
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 2
+#endif
+#else // SIMULATOR
+#undef TRACE_LEVEL
+#define TRACE_LEVEL 0
+#endif // SIMULATOR
+
+#if TRACE_LEVEL > 0
 
 #include "defs_types.h"
 
+#endif
+
+#if TRACE_LEVEL > 1
+
 void debugMessage(String message);
 void debugWarning(String warning);
 void debugError(String error);
@@ -33,7 +53,7 @@ void debugPointer(String label, ByteArray value);
 
 void debugValue(String label, ByteArray value, int length);
 
-#else // SIMULATOR
+#else // TRACE_LEVEL > 1
 
 #define debugMessage(P1)
 #define debugWarning(P1)
@@ -44,6 +64,22 @@ void debugValue(String label, ByteArray value, int length);
 
 #define debugValue(P1,P2,P3)
 
-#endif // SIMULATOR
+#endif // TRACE_LEVEL > 1
+
+#if TRACE_LEVEL > 0
+
+void debugCommand(Byte ins, Byte p1, Byte p2, int lc);
+void debugPrimitive(String primitive, int length1, int length2);
+void debugEnter(String function);
+void debugLeave(String function);
+
+#else // TRACE_LEVEL > 0
+
+#define debugCommand(P1,P2,P3,P4)
+#define debugPrimitive(P1,P2,P3)
+#define debugEnter(P1)
+#define debugLeave(P1)
+
+#endif // TRACE_LEVEL > 0
 
 #endif // __funcs_debug_H
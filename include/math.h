@@ -24,6 +24,7 @@
 #define __MATH_H
 
 #include "MULTOS.h"
+#include "funcs_debug.h"
 
 // x ^= y
 #define XorAssign(bytes, x, y) \
@@ -42,6 +43,7 @@
 
 #define ModMul(ModulusLength, LHS, RHS, Modulus) \
 do { \
+  debugPrimitive("ModMul", ModulusLength, 0); \
   __push(__typechk(unsigned int, ModulusLength)); \
   __push(__typechk(unsigned char *, LHS)); \
   __push(__typechk(unsigned char *, RHS)); \
@@ -49,13 +51,7 @@ do { \
   __code(PRIM, PRIM_MODULAR_MULTIPLICATION); \
 } while (0)
 
-#ifdef SIMULATOR
-#undef RSA_VERIFY
-#endif
-
-#ifdef RSA_VERIFY
-
-#define ModExp(ExponentLength, ModulusLength, Exponent, Modulus, Base, Result) \
+#define ModExpPrimitive(Primitive, ExponentLength, ModulusLength, Exponent, Modulus, Base, Result) \
 do { \
   __push(__typechk(unsigned int, ExponentLength)); \
   __push(__typechk(unsigned int, ModulusLength)); \
@@ -63,25 +59,74 @@ do { \
   __push(__typechk(const unsigned char *, Modulus)); \
   __push(__typechk(const unsigned char *, Base)); \
   __push(__typechk(unsigned char *, Result)); \
-  __code(PRIM, PRIM_RSA_VERIFY); \
+  __code(PRIM, Primitive); \
 } while (0)
 
+#ifdef SIMULATOR
+#undef RSA_VERIFY
+#endif
+
+#ifdef RSA_VERIFY
+  #define PRIM_MODEXP_PUBLIC PRIM_RSA_VERIFY
+#else
+  #define PRIM_MODEXP_PUBLIC PRIM_MODULAR_EXPONENTIATION
 #endif // RSA_VERIFY
 
+#define ModExp(ExponentLength, ModulusLength, Exponent, Modulus, Base, Result) \
+do { \
+  debugPrimitive("ModExp", ExponentLength, ModulusLength); \
+  ModExpPrimitive(PRIM_MODEXP_PUBLIC, ExponentLength, ModulusLength, Exponent, Modulus, Base, Result); \
+} while (0)
+
 #define ModExpSecure(ExponentLength, ModulusLength, Exponent, Modulus, Base, Result) \
 do { \
-  __push(__typechk(unsigned int, ExponentLength)); \
-  __push(__typechk(unsigned int, ModulusLength)); \
-  __push(__typechk(const unsigned char *, Exponent)); \
-  __push(__typechk(const unsigned char *, Modulus)); \
-  __push(__typechk(const unsigned char *, Base)); \
-  __push(__typechk(unsigned char *, Result)); \
-  __code(PRIM, PRIM_MODULAR_EXPONENTIATION); \
+  debugPrimitive("ModExpSecure", ExponentLength, ModulusLength); \
+  ModExpPrimitive(PRIM_MODULAR_EXPONENTIATION, ExponentLength, ModulusLength, Exponent, Modulus, Base, Result); \
 } while (0)
 
-#ifndef ModExp
-  #define ModExp ModExpSecure
-#endif // !ModExp
+// SHA-1 as provided by multoscrypto.h, traced for the cost model
+#define Hash(MessageLength, Digest, Message) \
+do { \
+  debugPrimitive("SHA1", MessageLength, 0); \
+  SHA1(MessageLength, Digest, Message); \
+} while (0)
+
+// SHA-1 over Message, continuing from the intermediate hash in State (all
+// zero for a fresh hash) after Count (4 bytes) bytes, both updated in place.
+// Full blocks only go into State, Digest gets the final hash of everything.
+#define HashIV(MessageLength, Digest, Message, State, Count) \
+do { \
+  debugPrimitive("SHA1", MessageLength, 0); \
+  __push(__typechk(unsigned int, MessageLength)); \
+  __push(__typechk(unsigned int, SHA1_BYTES)); \
+  __push(__typechk(unsigned char *, Digest)); \
+  __push(__typechk(const unsigned char *, Message)); \
+  __push(__typechk(unsigned char *, State)); \
+  __push(__typechk(unsigned char *, Count)); \
+  __push(__typechk(unsigned int, 0)); \
+  __push(__typechk(const unsigned char *, Message)); \
+  __code(PRIM, PRIM_SECURE_HASH_IV); \
+  __code(POPN, 4); \
+} while (0)
+
+// HashIV continuing a hash whose last RemainderLength bytes (not a full
+// block, so not in State yet) are at Remainder.  RemainderLength (an int
+// variable) is set to the length of the tail this call leaves unhashed.
+#define HashIVRemainder(MessageLength, Digest, Message, State, Count, RemainderLength, Remainder) \
+do { \
+  debugPrimitive("SHA1", (RemainderLength) + (MessageLength), 0); \
+  __push(__typechk(unsigned int, MessageLength)); \
+  __push(__typechk(unsigned int, SHA1_BYTES)); \
+  __push(__typechk(unsigned char *, Digest)); \
+  __push(__typechk(const unsigned char *, Message)); \
+  __push(__typechk(unsigned char *, State)); \
+  __push(__typechk(unsigned char *, Count)); \
+  __push(__typechk(unsigned int, RemainderLength)); \
+  __push(__typechk(const unsigned char *, Remainder)); \
+  __code(PRIM, PRIM_SECURE_HASH_IV); \
+  __code(POPN, 2); \
+  __code(STORE, &(RemainderLength), 2); \
+} while (0)
 
 extern unsigned char MATH_flag;
 
@@ -19,10 +19,14 @@
 
 #include "funcs_debug.h" 
 
-#ifdef SIMULATOR
+#if TRACE_LEVEL > 0
 
 #include <stdio.h> // for printf()
 
+#endif
+
+#if TRACE_LEVEL > 1
+
 /********************************************************************/
 /* Debug functions                                                  */
 /********************************************************************/
@@ -47,14 +51,48 @@ void debugPointer(String label, ByteArray value) {
   printf("%s: %p\n", label, value);
 }
 
+// Values are hex encoded in chunks, one printf() per 32 bytes
+#define VALUE_CHUNK 32
+
 void debugValue(String label, ByteArray value, int length) {
-  int i;
+  static const char hex[] = "0123456789ABCDEF";
+  char line[2 * VALUE_CHUNK + 1];
+  int i, j;
 
   printf("%s: ", label);
-  for (i = 0; i < length; i++) {
-    printf("%02X", value[i]);
+  for (i = 0; i < length; i += VALUE_CHUNK) {
+    for (j = 0; j < VALUE_CHUNK && i + j < length; j++) {
+      line[2 * j] = hex[value[i + j] >> 4];
+      line[2 * j + 1] = hex[value[i + j] & 0x0F];
+    }
+    line[2 * j] = '\0';
+    printf("%s", line);
   }
   printf("\n");
 }
 
-#endif // SIMULATOR
+#endif // TRACE_LEVEL > 1
+
+#if TRACE_LEVEL > 0
+
+/********************************************************************/
+/* Trace events, parsed by tools/costmodel.py and friends           */
+/********************************************************************/
+
+void debugCommand(Byte ins, Byte p1, Byte p2, int lc) {
+  printf("[CMD] %02X %02X %02X %d\n", ins, p1, p2, lc);
+}
+
+void debugPrimitive(String primitive, int length1, int length2) {
+  printf("[PRM] %s %d %d\n", primitive, length1, length2);
+}
+
+void debugEnter(String function) {
+  printf("[FUN] > %s\n", function);
+}
+
+void debugLeave(String function) {
+  printf("[FUN] < %s\n", function);
+}
+
+#endif // TRACE_LEVEL > 0
@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "defs_apdu.h"
+#include "defs_groups.h"
 #include "defs_sizes.h"
 #include "defs_types.h"
 #include "funcs_debug.h"
@@ -49,25 +50,16 @@ union {
 // The fixed values are from the U-Porve Cryptographic Specification V1.0
 // to ease testing
 
-NUMBER_PSIZE p = {
-    0x00,
-    0xd2, 0x1a, 0xe8, 0xd6, 0x6e, 0x6c, 0x6b, 0x3c, 0xed, 0x0e, 0xb3, 0xdf, 0x1a, 0x26, 0xc9, 0x1b, 0xde, 0xed, 0x01, 0x3c, 0x17, 0xd8, 0x49, 0xd3, 0x0e, 0xc3, 0x09, 0x81, 0x3e, 0x4d, 0x37, 0x99,
-    0xf2, 0x6d, 0xb0, 0xd4, 0x94, 0xe8, 0x2e, 0xc6, 0x1e, 0xa9, 0xfd, 0xc7, 0x0b, 0xb5, 0xcb, 0xca, 0xf2, 0xe5, 0xf1, 0x8a, 0x83, 0x64, 0x94, 0xf5, 0x8e, 0x67, 0xc6, 0xd6, 0x16, 0x48, 0x0c, 0x37,
-    0xa7, 0xf2, 0x30, 0x61, 0x01, 0xfc, 0x9f, 0x0f, 0x47, 0x68, 0xf9, 0xc9, 0x79, 0x3c, 0x2b, 0xe1, 0x76, 0xb0, 0xb7, 0xc9, 0x79, 0xb4, 0x06, 0x5d, 0x3e, 0x83, 0x56, 0x86, 0xa3, 0xf0, 0xb8, 0x42,
-    0x0c, 0x68, 0x34, 0xcb, 0x17, 0x93, 0x03, 0x86, 0xde, 0xda, 0xb2, 0xb0, 0x7d, 0xd4, 0x73, 0x44, 0x9a, 0x48, 0xba, 0xab, 0x31, 0x62, 0x86, 0xb4, 0x21, 0x05, 0x24, 0x75, 0xd1, 0x34, 0xcd, 0x3b
-};
+NUMBER_PSIZE p = GROUP_UPROVE_TEST_1024_P;
 
-NUMBER_PSIZE g = {
-    0x00, 
-    0xab, 0xce, 0xc9, 0x72, 0xe9, 0xa9, 0xdd, 0x8d, 0x13, 0x32, 0x70, 0xcf, 0xea, 0xc2, 0x6f, 0x72, 0x6e, 0x56, 0x7d, 0x96, 0x47, 0x57, 0x63, 0x0d, 0x6b, 0xd4, 0x34, 0x60, 0xd0, 0x92, 0x3a, 0x46,
-    0xae, 0xc0, 0xac, 0xe2, 0x55, 0xeb, 0xf3, 0xdd, 0xd4, 0xb1, 0xc4, 0x26, 0x4f, 0x53, 0xe6, 0x8b, 0x36, 0x1a, 0xfb, 0x77, 0x7a, 0x13, 0xcf, 0x00, 0x67, 0xda, 0xe3, 0x64, 0xa3, 0x4d, 0x55, 0xa0,
-    0x96, 0x5a, 0x6c, 0xcc, 0xf7, 0x88, 0x52, 0x78, 0x29, 0x23, 0x81, 0x3c, 0xf8, 0x70, 0x88, 0x34, 0xd9, 0x1f, 0x65, 0x57, 0xd7, 0x83, 0xec, 0x75, 0xb5, 0xf3, 0x7c, 0xd9, 0x18, 0x5f, 0x02, 0x7b,
-    0x04, 0x2c, 0x1c, 0x72, 0xe1, 0x21, 0xb1, 0x26, 0x6a, 0x40, 0x8b, 0xe0, 0xbb, 0x72, 0x70, 0xd6, 0x59, 0x17, 0xb6, 0x90, 0x83, 0x63, 0x3e, 0x1f, 0x3c, 0xd6, 0x06, 0x24, 0x61, 0x2f, 0xc8, 0xc1
-};
+NUMBER_PSIZE g = GROUP_UPROVE_TEST_1024_G;
+
+NUMBER_QSIZE q = GROUP_UPROVE_TEST_1024_Q;
 
-NUMBER_QSIZE q = { 0x00, 0xff, 0xf8, 0x0a, 0xe1, 0x9d, 0xae, 0xbc, 0x61, 0xf4, 0x63, 0x56, 0xaf, 0x09, 0x35, 0xdc, 0x0e, 0x81, 0x14, 0x8e, 0xb1 };
+NUMBER_QSIZE q_minus_2 = GROUP_UPROVE_TEST_1024_Q_MINUS_2;
 
-NUMBER_QSIZE q_minus_2 = { 0x00, 0xff, 0xf8, 0x0a, 0xe1, 0x9d, 0xae, 0xbc, 0x61, 0xf4, 0x63, 0x56, 0xaf, 0x09, 0x35, 0xdc, 0x0e, 0x81, 0x14, 0x8e, 0xaf };
+// Which group p, q and g hold, so that the host can skip uploading them
+unsigned char group = GROUP_UPROVE_TEST_1024;
 
 unsigned char TI[] = "Token information field value";
 
@@ -82,6 +74,39 @@ unsigned char S[] = "Issuer parameters specification";
 
 char rcounter = 0;
 
+// The defaults below cover up to 5 attributes, larger builds get empty
+// entries (to be personalised) so that the g_t and x_t entries stay last
+#if MAX_ATTR > 5
+#define NO_DEFAULT { 0x00 },
+#endif
+#if MAX_ATTR == 6
+#define DEFAULT_PADDING NO_DEFAULT
+#elif MAX_ATTR == 7
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 8
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 9
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 10
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 11
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 12
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 13
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 14
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 15
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR == 16
+#define DEFAULT_PADDING NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT NO_DEFAULT
+#elif MAX_ATTR > 16
+#error DEFAULT_PADDING only covers MAX_ATTR up to 16, extend the ladder
+#else
+#define DEFAULT_PADDING
+#endif
+
 NUMBER_PSIZE g_i[MAX_ATTR + 2] = { // i = 0,...,n,t
     // default test vectors
     // g0
@@ -130,6 +155,7 @@ NUMBER_PSIZE g_i[MAX_ATTR + 2] = { // i = 0,...,n,t
     0x85, 0xfc, 0x9c, 0x7a, 0xca, 0x09, 0x8c, 0x17, 0x2d, 0xde, 0x7e, 0xaf, 0x01, 0xb7, 0x02, 0x83, 0x17, 0x07, 0x8d, 0x65, 0x90, 0x48, 0x82, 0x48, 0x2c, 0xa1, 0x3f, 0x14, 0xe2, 0xb2, 0xad, 0x0c,
     0xd7, 0xed, 0x80, 0x18, 0x4f, 0x73, 0x37, 0xf9, 0xa1, 0xac, 0xb7, 0x98, 0x43, 0xef, 0x98, 0xb8, 0x78, 0x24, 0x98, 0x4d, 0x2f, 0x83, 0xb6, 0x4e, 0x58, 0x68, 0xa3, 0x49, 0x20, 0x46, 0x01, 0x65,
 #endif
+    DEFAULT_PADDING
     // gt
     0x00,
     0x06, 0x61, 0xa8, 0x57, 0xea, 0x4b, 0x1c, 0xbb, 0x0b, 0x8f, 0xb3, 0x5a, 0x4a, 0xe3, 0x30, 0x12, 0x34, 0xa9, 0x93, 0xe4, 0x97, 0xee, 0x06, 0xb0, 0x6a, 0x13, 0x00, 0xe8, 0xfc, 0xf6, 0x56, 0x51,
@@ -185,6 +211,7 @@ NUMBER_PSIZE z_i[MAX_ATTR + 2] = { // i = 0,...,n,t
 	0xf2, 0xd1, 0x38, 0x1a, 0xdd, 0x8b, 0x90, 0x5f, 0x1c, 0x4b, 0xae, 0xfa, 0xab, 0x27, 0xf0, 0x1a, 0x0d, 0x66, 0x41, 0x24, 0xee, 0x3c, 0x86, 0xca, 0xb9, 0xc4, 0xee, 0xe7, 0xf0, 0x58, 0xa0, 0x98, 
 	0x4f, 0xa2, 0x18, 0xc7, 0x16, 0x33, 0xc8, 0x61, 0xd7, 0xe3, 0x3a, 0x8f, 0x69, 0x19, 0x91, 0x22, 0x3f, 0x54, 0x77, 0x7c, 0xc5, 0xe5, 0x4e, 0x70, 0x23, 0x57, 0x16, 0x35, 0x68, 0x8b, 0x77, 0x2a,
 #endif
+    DEFAULT_PADDING
     // zt:
     0x00,
     0xbf, 0xab, 0x41, 0xde, 0xbc, 0x7d, 0x75, 0x91, 0x82, 0x88, 0xf8, 0xa5, 0xa9, 0x5c, 0x19, 0xa3, 0x68, 0xd1, 0x98, 0x1d, 0xb1, 0x04, 0x43, 0x1d, 0x4d, 0xf9, 0xaf, 0x6f, 0x92, 0x94, 0x7f, 0x7f, 
@@ -214,107 +241,90 @@ NUMBER_QSIZE x_i[MAX_ATTR + 1] = { // i = 1,...,n,t counting from 0
     // x5:
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x49, 0x96, 0x02, 0xd2,
 #endif
+    DEFAULT_PADDING
     // xt:
     0x00, 0xc4, 0x30, 0x8f, 0xf1, 0x4c, 0xad, 0xbe, 0x9e, 0x0a, 0x12, 0x00, 0xb7, 0xf6, 0x64, 0x00, 0xce, 0x44, 0x71, 0xe7, 0x7f
     };
 
-ATTRIBUTE A_i[MAX_ATTR] = { // i = 1, ..., n
+// Number of attributes n of the current issuer parameters, the arrays
+// below hold MAX_ATTR but only i = 1, ..., n (and t at n + 1) are used
+unsigned char attrCount = MAX_ATTR;
+
+// Attribute values, packed one after the other in attrHeap; setting an
+// attribute appends its new value and compactAttributes() squeezes out
+// the old ones when the heap runs full
+unsigned char attrHeap[ATTR_HEAP_SIZE] = {
+#if MAX_ATTR > 0
+   // A_1: "Alice Smith"
+   0x41, 0x6c, 0x69, 0x63, 0x65, 0x20, 0x53, 0x6d, 0x69, 0x74, 0x68,
+#endif
+#if MAX_ATTR > 1
+   // A_2: "WA"
+   0x57, 0x41,
+#endif
+#if MAX_ATTR > 2
+   // A_3: "1010 Crypto Street"
+   0x31, 0x30, 0x31, 0x30, 0x20, 0x43, 0x72, 0x79, 0x70, 0x74, 0x6f, 0x20, 0x53, 0x74, 0x72, 0x65, 0x65, 0x74,
+#endif
+#if MAX_ATTR > 3
+   // A_4: 0x01
+   0x01,
+#endif
+#if MAX_ATTR > 4
+   // A_5: 0x499602d2
+   0x49, 0x96, 0x02, 0xd2,
+#endif
+};
+
+unsigned int attrOffset[MAX_ATTR] = { // i = 1, ..., n
+#if MAX_ATTR > 0
+   0,
+#endif
+#if MAX_ATTR > 1
+   11,
+#endif
+#if MAX_ATTR > 2
+   13,
+#endif
+#if MAX_ATTR > 3
+   31,
+#endif
+#if MAX_ATTR > 4
+   32,
+#endif
+};
+
+unsigned char attrSize[MAX_ATTR] = { // i = 1, ..., n
 #if MAX_ATTR > 0
    11,
-   0x41, 0x6c, 0x69, 0x63, 0x65, 0x20, 0x53, 0x6d, 0x69, 0x74, 0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 #endif
 #if MAX_ATTR > 1
    2,
-   0x57, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 #endif
 #if MAX_ATTR > 2
    18,
-   0x31, 0x30, 0x31, 0x30, 0x20, 0x43, 0x72, 0x79, 0x70, 0x74, 0x6f, 0x20, 0x53, 0x74, 0x72, 0x65,
-   0x65, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 #endif
 #if MAX_ATTR > 3
    1,
-   0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 #endif
 #if MAX_ATTR > 4
    4,
-   0x49, 0x96, 0x02, 0xd2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 #endif
-   };	
+};
+
+// End of the last value in attrHeap
+unsigned int attrHeapUsed =
+#if MAX_ATTR > 4
+   36;
+#elif MAX_ATTR > 3
+   32;
+#elif MAX_ATTR > 2
+   31;
+#elif MAX_ATTR > 1
+   13;
+#elif MAX_ATTR > 0
+   11;
+#endif
 
 unsigned char e_i[MAX_ATTR] = { 
 #if MAX_ATTR > 0
@@ -439,14 +449,35 @@ typedef struct {
                              // Total now: 321
 } TEMP_SPACE;
 
+typedef struct {
+   unsigned char left[4];            // 4 bytes, value bytes still to come, big endian
+   unsigned char state[SHA1_BYTES];  // 20 bytes, SHA-1 over the chunks so far
+   unsigned char count[4];           // 4 bytes, bytes in state
+                                     // Total now: 28
+} STREAM_SPACE;
+
 union {
   TEMP_SPACE vars;                    // 321 bytes or
-  unsigned char array[256 + 72];      // 328 bytes
+  STREAM_SPACE stream;                // 28 bytes, during CMD_INIT_STREAM_ATTRVAL or
+  unsigned char array[TEMP_RAM_SIZE];  // 328 bytes up to MAX_ATTR = 11 (F_ENCODED_SIZE above)
 } temp_ram;
 
+typedef struct {
+   unsigned char state[SHA1_BYTES]; // 20 bytes, SHA-1 over h, PI and most of sigma_z_prime
+   unsigned char count[4];          // 4 bytes, bytes in state
+   int tail;                 // 2 bytes, bytes of sigma_z_prime left out of state
+   int end;                  // 2 bytes, where they end in tempArray
+                             // Total now: 28
+} HASH_SPACE;
+
 unsigned char UD[MAX_ATTR]; // D-s are marked 0x01,  U-s are marked 0x00
 
-NUMBER_QSIZE w_i[MAX_ATTR + 1] = { // 0, 1, ... n
+// The w_i only live during challengeM(), so they share their space with the
+// hash for sigma_c_prime from doPrecomputations() to sigmaBCommittment()
+union {
+  NUMBER_QSIZE w_i[MAX_ATTR + 1];     // 42 bytes or more
+  HASH_SPACE hash;                    // 28 bytes
+} w_ram = { // w_i, i = 0, 1, ... n
     // w0:
     0x00, 0x7d, 0xfa, 0x99, 0x36, 0x4b, 0xa7, 0xb2, 0xcf, 0x01, 0x4d, 0x54, 0x71, 0x21, 0x1e, 0x1d, 0xc0, 0x58, 0x01, 0x6f, 0xad,
 #if MAX_ATTR > 0
@@ -501,8 +532,13 @@ NUMBER_QSIZE c = { 0x00, 0xbf, 0x4a, 0xfc, 0xc7, 0x13, 0x26, 0x51, 0xa3, 0xaa, 0
 
 NUMBER_PSIZE t;
 
+// Attribute being uploaded with CMD_INIT_STREAM_ATTRVAL, 0 for none, its
+// state is in temp_ram so any other command ends the upload
+unsigned char streamIndex;
+
 // Safe assumption is that we have 800 bytes
-// So far 294 + 328 + 129 bytes
+// So far 299 + 328 + 129 + 1 bytes, i.e. 757 for MAX_ATTR = 5 and 800 for
+// MAX_ATTR = 6 (UD, w_i and r_i grow with MAX_ATTR, see tools/scaling.py)
 
 #pragma melstatic
 
@@ -520,45 +556,69 @@ int putNumberIntoArray(int length, unsigned char *number, unsigned char *array)
 	int i = 0;
 	int skip = 0;
 	int actualLength = 0;
+	debugEnter("putNumberIntoArray");
 	if(length == PSIZE_BYTES || length == QSIZE_BYTES) {
        while(number[skip] == 0x00) skip++;
 	}
 	actualLength = length - skip;
 	putIntIntoArray(actualLength, array);
 	offset += 4;
+	debugPrimitive("Copy", actualLength, 0);
 	memcpy(array + offset, number + skip, actualLength);
 	offset += actualLength;
+	debugLeave("putNumberIntoArray");
 	return offset;
 }
 
 // TODO try this without hashing, perhaps would be faster
 void generateRandom20Bytes(unsigned char *dest) {
    unsigned char temp[9];
+   debugPrimitive("Random", 8, 0);
    GetRandomNumber(temp);
    temp[8] = rcounter++;
-   SHA1(9, dest, temp);
+   Hash(9, dest, temp);
+}
+
+/**
+  * dest := src - 2 over length bytes, borrowing across bytes: the exponent
+  * for inverses mod q (q - 2) and mod p (p - 2)
+  */
+void minus2(int length, unsigned char *dest, unsigned char *src) {
+   int i = length - 1;
+   unsigned char borrow = src[i] < 2;
+   memcpy(dest, src, length);
+   dest[i] -= 2;
+   while(borrow && i > 0) {
+      i--;
+      borrow = dest[i] == 0;
+      dest[i]--;
+   }
 }
 
 void calcGamma(void) {
    int i;
+   debugEnter("calcGamma");
    // gamma = g_0 g_1 ^ x_1 ... g_n ^ x_n g_t ^ x_t mod p
    gamma = g_i[0];
-   for(i = 1; i < MAX_ATTR + 2; i++) {
+   for(i = 1; i < attrCount + 2; i++) {
       ModExp(QSIZE_BYTES, PSIZE_BYTES, x_i[i-1].number, p.number, g_i[i].number, t.number);
       ModMul(PSIZE_BYTES, gamma.number, t.number, p.number);
    }
    debugValue("gamma", gamma.number, PSIZE_BYTES);
+   debugLeave("calcGamma");
 }
 
 void calcSigmaZ(void) {
    int i;
+   debugEnter("calcSigmaZ");
    // sigma_z = z_0 z_1 ^ x_1 ... z_n ^ x_n z_t ^ x_t mod p
    sigma_z = z_i[0];
-   for(i = 1; i < MAX_ATTR + 2; i++) {
+   for(i = 1; i < attrCount + 2; i++) {
       ModExp(QSIZE_BYTES, PSIZE_BYTES, x_i[i-1].number, p.number, z_i[i].number, t.number);
       ModMul(PSIZE_BYTES, sigma_z.number, t.number, p.number);
    }
    debugValue("sigma_z", sigma_z.number, PSIZE_BYTES);
+   debugLeave("calcSigmaZ");
 }
 
 /**
@@ -590,33 +650,37 @@ void generateRandomAlphaBeta(void) {
 void computeXt(void) {
    int i;
    int offset = 0;
+   debugEnter("computeXt");
    
    offset += putNumberIntoArray(UID_p_length, UID_p, tempArray+offset);
    offset += putNumberIntoArray(PSIZE_BYTES, p.number, tempArray+offset);
    offset += putNumberIntoArray(QSIZE_BYTES, q.number, tempArray+offset);
    offset += putNumberIntoArray(PSIZE_BYTES, g.number, tempArray+offset);
-   putIntIntoArray(MAX_ATTR+2, tempArray+offset); offset += 4;
-   for(i=0;i<MAX_ATTR+2;i++) {
+   putIntIntoArray(attrCount+2, tempArray+offset); offset += 4;
+   for(i=0;i<attrCount+2;i++) {
        offset += putNumberIntoArray(PSIZE_BYTES, g_i[i].number, tempArray+offset);
    }   
-   putIntIntoArray(MAX_ATTR, tempArray+offset); offset += 4;
-   for(i=0;i<MAX_ATTR;i++) {
+   putIntIntoArray(attrCount, tempArray+offset); offset += 4;
+   for(i=0;i<attrCount;i++) {
        tempArray[offset++] = e_i[i];
    }   
    offset += putNumberIntoArray(S_length, S, tempArray+offset);
    //debugValue("P before", tempArray, offset);   
-   SHA1(offset, t.number, tempArray);
+   Hash(offset, t.number, tempArray);
    debugValue("P", t.number, QSIZE_BYTES);
    offset = 0;
    temp_ram.array[offset++] = 0x01;
    offset += putNumberIntoArray(QSIZE_BYTES, t.number, temp_ram.array+offset);
    offset += putNumberIntoArray(TI_length, TI, temp_ram.array+offset);
-   SHA1(offset, x_i[MAX_ATTR].number, temp_ram.array);
-   ModularReduction(QSIZE_BYTES, QSIZE_BYTES, x_i[MAX_ATTR].number, q.number);
-   debugValue("x_t", x_i[MAX_ATTR].number, QSIZE_BYTES);
+   Hash(offset, x_i[attrCount].number, temp_ram.array);
+   ModularReduction(QSIZE_BYTES, QSIZE_BYTES, x_i[attrCount].number, q.number);
+   debugValue("x_t", x_i[attrCount].number, QSIZE_BYTES);
+   debugLeave("computeXt");
 }
 	
 void doPrecomputations(void) {
+     int offset = 0;
+     debugEnter("doPrecomputations");
      generateRandomAlphaBeta();
 
      // h = gamma ^ alpha mod p
@@ -642,7 +706,21 @@ void doPrecomputations(void) {
      // Compute alpha ^ -1 mod q <==> alpha ^ (q-2) mod q
      ModExpSecure(QSIZE_BYTES, QSIZE_BYTES, q_minus_2.number, q.number, temp_ram.vars.alpha.number, alphaInverse.number);
      debugValue("alphaInverse", alphaInverse.number, QSIZE_BYTES);
-     
+
+     // h, PI and sigma_z_prime open the hash for sigma_c_prime, so hash
+     // their full blocks now and leave only the tail, kept at the end of
+     // their encoding in tempArray, for sigmaBCommittment()
+     offset += putNumberIntoArray(PSIZE_BYTES, h.number, tempArray+offset);
+     offset += putNumberIntoArray(PI_length, PI, tempArray+offset);
+     offset += putNumberIntoArray(PSIZE_BYTES, sigma_z_prime.number, tempArray+offset);
+     CLEARN(SHA1_BYTES, w_ram.hash.state);
+     CLEARN(4, w_ram.hash.count);
+     w_ram.hash.tail = 0;
+     w_ram.hash.end = offset;
+     HashIVRemainder(offset, t.number, tempArray, w_ram.hash.state, w_ram.hash.count,
+                     w_ram.hash.tail, tempArray);
+
+     debugLeave("doPrecomputations");
 }
 
 void sigmaACommittment(void) {
@@ -654,7 +732,9 @@ void sigmaACommittment(void) {
 }
 
 void sigmaBCommittment(void) {
-    int offset = 0;
+    int offset = w_ram.hash.end;
+    int tail = w_ram.hash.tail;
+    debugEnter("sigmaBCommittment");
     // APDU contains sigma_b
     // sigma_b_prime = t_b * sigma_a ^ alpha mod p
     ModExpSecure(QSIZE_BYTES, PSIZE_BYTES, temp_ram.vars.alpha.number, p.number, apdu_data.number_p_size, sigma_b_prime.number);
@@ -662,14 +742,16 @@ void sigmaBCommittment(void) {
     debugValue("sigma_b_prime", sigma_b_prime.number, PSIZE_BYTES);
 
     // sigma_c_prime = H(h, PI, sigma_z_prime, sigma_a_prime, sigma_b_prime) mod q
-   
-	offset += putNumberIntoArray(PSIZE_BYTES, h.number, tempArray+offset);
-	offset += putNumberIntoArray(PI_length, PI, tempArray+offset);
-	offset += putNumberIntoArray(PSIZE_BYTES, sigma_z_prime.number, tempArray+offset);
+    // continuing from the state left by doPrecomputations(), which is copied
+    // so that the command can be repeated.  The remainder it left, the end
+    // of sigma_z_prime, is still in tempArray in front of sigma_a_prime.
 	offset += putNumberIntoArray(PSIZE_BYTES, sigma_a_prime.number, tempArray+offset);
 	offset += putNumberIntoArray(PSIZE_BYTES, sigma_b_prime.number, tempArray+offset);
-    debugValue("tempArray", tempArray, offset);
-    SHA1(offset, sigma_c_prime.number, tempArray);
+    debugValue("tempArray", tempArray+w_ram.hash.end-tail, offset-w_ram.hash.end+tail);
+    COPYN(SHA1_BYTES, t.number, w_ram.hash.state);
+    COPYN(4, t.number+SHA1_BYTES, w_ram.hash.count);
+    HashIVRemainder(offset-w_ram.hash.end, sigma_c_prime.number, tempArray+w_ram.hash.end,
+                    t.number, t.number+SHA1_BYTES, tail, tempArray+w_ram.hash.end-tail);
     debugValue("sigma_c_prime1", sigma_c_prime.number, QSIZE_BYTES);
     ModularReduction(QSIZE_BYTES, QSIZE_BYTES, sigma_c_prime.number, q.number);
 	// sigma_c_prime.number[0] = 0;
@@ -684,6 +766,7 @@ void sigmaBCommittment(void) {
     debugValue("sigma_c", t.number, QSIZE_BYTES);
 
     COPYN(QSIZE_BYTES, apdu_data.number_q_size, t.number);
+    debugLeave("sigmaBCommittment");
 }
 
 void computeTokenID(void) {
@@ -692,7 +775,7 @@ void computeTokenID(void) {
     offset += putNumberIntoArray(PSIZE_BYTES, sigma_z_prime.number, temp_ram.array+offset);
     offset += putNumberIntoArray(QSIZE_BYTES, sigma_c_prime.number, temp_ram.array+offset);
     offset += putNumberIntoArray(QSIZE_BYTES, sigma_r_prime.number, temp_ram.array+offset);
-    SHA1(offset, UID_t.number, temp_ram.array);
+    Hash(offset, UID_t.number, temp_ram.array);
     ModularReduction(QSIZE_BYTES, QSIZE_BYTES, UID_t.number, q.number);
     debugValue("UID_t", UID_t.number, QSIZE_BYTES);
 }
@@ -701,6 +784,7 @@ int sigmaRCommittment(int verify) {
     // APDU contains sigma_r
     // tA := sigma_r
     int result = 1; // true
+    debugEnter(verify ? "sigmaRCommittment(1)" : "sigmaRCommittment(0)");
     t.number_w[0] = 0;
     COPYN(QSIZE_BYTES, t.number, apdu_data.number_q_size);
 
@@ -715,8 +799,7 @@ int sigmaRCommittment(int verify) {
     // verify signature, make it boolean result of this function
     if(verify) {
        result = 0;
-       COPYN(PSIZE_BYTES, tempArray, p.number);
-	   tempArray[PSIZE_BYTES - 1] = tempArray[PSIZE_BYTES - 1] - 2;
+       minus2(PSIZE_BYTES, tempArray, p.number);
        // tempArray has p - 2 (for modular inverse)
        COPYN(PSIZE_BYTES, tempArray+PSIZE_BYTES, g_i[0].number);
        ModMul(PSIZE_BYTES, tempArray+PSIZE_BYTES, sigma_z_prime.number, p.number);
@@ -742,6 +825,7 @@ int sigmaRCommittment(int verify) {
        }
        
     }
+    debugLeave(verify ? "sigmaRCommittment(1)" : "sigmaRCommittment(0)");
     return result;
 }
 
@@ -751,34 +835,34 @@ void selectD(int len) {
     CLEARN(MAX_ATTR, UD);
     for(i = 0; i < len; i++) {
       j = apdu_data.D_data[i] - 1;
-      if(j < 0 || j >= MAX_ATTR) {
+      if(j < 0 || j >= attrCount) {
          ExitSW(ERR_WRONGDATA);
       }
       UD[j] = 0x01;
     }
-    debugValue("UD", UD, MAX_ATTR);
+    debugValue("UD", UD, attrCount);
 }
 
 void generateRandomWi(void) {
    int i = 0;
    if(testMode) {
      // Use the fixed test data
-     COPYN((QSIZE_BYTES+1)*(MAX_ATTR+1), w_i[0].number_w, w_iTest[0].number_w);
+     COPYN((QSIZE_BYTES+1)*(attrCount+1), w_ram.w_i[0].number_w, w_iTest[0].number_w);
    }else{
-     CLEARN((QSIZE_BYTES+1)*(MAX_ATTR+1), w_i[0].number_w);
+     CLEARN((QSIZE_BYTES+1)*(attrCount+1), w_ram.w_i[0].number_w);
      // generate w_i, i = 0, 1, ..., n
-     for(i = 0; i < MAX_ATTR + 1; i++) {
+     for(i = 0; i < attrCount + 1; i++) {
         if(i != 0) {
            if(UD[i-1]) continue;   // i is in D, not interested
         }
-		generateRandom20Bytes(w_i[i].number);
-        w_i[i].number_w[0] = 0;
-        ModularReduction(QSIZE_BYTES, QSIZE_BYTES, w_i[i].number, q.number);
+		generateRandom20Bytes(w_ram.w_i[i].number);
+        w_ram.w_i[i].number_w[0] = 0;
+        ModularReduction(QSIZE_BYTES, QSIZE_BYTES, w_ram.w_i[i].number, q.number);
      }
    }
-#ifdef SIMULATOR
-   for(i = 0; i < MAX_ATTR + 1; i++) {
-      debugValue("w_i", w_i[i].number, QSIZE_BYTES);
+#if TRACE_LEVEL > 1
+   for(i = 0; i < attrCount + 1; i++) {
+      debugValue("w_i", w_ram.w_i[i].number, QSIZE_BYTES);
    }
 #endif
 }
@@ -787,11 +871,12 @@ void generateChallengeC(void) {
    int i;
    int D_length = 0;
    int offset = 0;
+   debugEnter("generateChallengeC");
    // apdu_data contains challenge m
    debugValue("m", apdu_data.raw_data, Lc);
    // Put [D] into buffer
    offset = 4;
-   for(i=0;i<MAX_ATTR;i++) {
+   for(i=0;i<attrCount;i++) {
      if(UD[i]) {
        D_length++;
        putIntIntoArray(i+1, temp_ram.array+offset);
@@ -800,9 +885,9 @@ void generateChallengeC(void) {
    }
    putIntIntoArray(D_length, temp_ram.array);
    // put [f_1,...,f_n] into buffer
-   putIntIntoArray(MAX_ATTR, temp_ram.array + offset);
+   putIntIntoArray(attrCount, temp_ram.array + offset);
    offset += 4;
-   for(i=0;i<MAX_ATTR;i++) {
+   for(i=0;i<attrCount;i++) {
      if(UD[i]) {
        offset += putNumberIntoArray(QSIZE_BYTES, x_i[i].number, temp_ram.array+offset);
      }else{
@@ -810,10 +895,10 @@ void generateChallengeC(void) {
        offset += 4;
      }
    }
-   // Here max bytes is 148
+   // Here max bytes is F_ENCODED_SIZE, 148 for 5 attributes
    debugValue("F before H()", temp_ram.array, offset);
    // t.number holds F
-   SHA1(offset, t.number, temp_ram.array);
+   Hash(offset, t.number, temp_ram.array);
    debugValue("F", t.number, QSIZE_BYTES);
 
    offset = 0;
@@ -821,27 +906,29 @@ void generateChallengeC(void) {
    offset += putNumberIntoArray(QSIZE_BYTES, a.number, temp_ram.array+offset);
    offset += putNumberIntoArray(Lc, apdu_data.raw_data, temp_ram.array+offset);
    offset += putNumberIntoArray(QSIZE_BYTES, t.number, temp_ram.array+offset);
-   SHA1(offset, c.number, temp_ram.array);
+   Hash(offset, c.number, temp_ram.array);
    ModularReduction(QSIZE_BYTES, QSIZE_BYTES, c.number, q.number);
    c.number_w[0] = 0;
    debugValue("c", c.number, QSIZE_BYTES);
+   debugLeave("generateChallengeC");
 }
 
 void challengeM(void) {
     int i=0;
     int offset = 0;
+    debugEnter("challengeM");
     generateRandomWi();    
     // Calculate a 
-    ModExp(QSIZE_BYTES, PSIZE_BYTES, w_i[0].number, p.number, h.number, t.number);
-    for(i = 0; i < MAX_ATTR; i++) {
+    ModExp(QSIZE_BYTES, PSIZE_BYTES, w_ram.w_i[0].number, p.number, h.number, t.number);
+    for(i = 0; i < attrCount; i++) {
        if(UD[i]) continue; // i is in D, not interested
-       ModExp(QSIZE_BYTES, PSIZE_BYTES, w_i[i+1].number, p.number, g_i[i+1].number, temp_ram.vars.a.number);
+       ModExp(QSIZE_BYTES, PSIZE_BYTES, w_ram.w_i[i+1].number, p.number, g_i[i+1].number, temp_ram.vars.a.number);
        ModMul(PSIZE_BYTES, t.number, temp_ram.vars.a.number, p.number);
     }
     // t now contains h^w_0 * prod i in U g_i^w_i mod p
     offset += putNumberIntoArray(PSIZE_BYTES, t.number, temp_ram.array+offset);
     // a := H(t)
-    SHA1(offset, a.number, temp_ram.array);
+    Hash(offset, a.number, temp_ram.array);
     ModularReduction(QSIZE_BYTES, QSIZE_BYTES, a.number, q.number);
     debugValue("a", a.number, QSIZE_BYTES);
     generateChallengeC();
@@ -849,17 +936,17 @@ void challengeM(void) {
     // compute r_i i = 0
     COPYN(QSIZE_BYTES+1, t.number_w, c.number_w);
     ModMul(QSIZE_BYTES, t.number, alphaInverse.number, q.number);
-    ADDN(QSIZE_BYTES + 1, r_i[0].number_w, t.number_w, w_i[0].number_w);
+    ADDN(QSIZE_BYTES + 1, r_i[0].number_w, t.number_w, w_ram.w_i[0].number_w);
     if(r_i[0].number_w[0]) { r_i[0].number_w[0] = 0; ASSIGN_SUBN(QSIZE_BYTES+1, r_i[0].number_w, q.number_w); r_i[0].number_w[0] = 0; }
     debugValue("r_i", r_i[0].number, QSIZE_BYTES);
 
     // compute r_i i = 1,..., n i in U
-    for(i = 0; i < MAX_ATTR; i++) {
+    for(i = 0; i < attrCount; i++) {
        if(UD[i]) continue; // i is in D, not interested
        COPYN(QSIZE_BYTES+1, t.number_w, c.number_w);
-       COPYN(QSIZE_BYTES+1, w_i[0].number_w, w_i[i+1].number_w);
+       COPYN(QSIZE_BYTES+1, w_ram.w_i[0].number_w, w_ram.w_i[i+1].number_w);
        ModMul(QSIZE_BYTES, t.number, x_i[i].number, q.number);
-       SUBN(QSIZE_BYTES + 1, temp_ram.array, w_i[0].number_w, t.number_w);
+       SUBN(QSIZE_BYTES + 1, temp_ram.array, w_ram.w_i[0].number_w, t.number_w);
        if(temp_ram.array[0]) { temp_ram.array[0] = 0; ASSIGN_ADDN(QSIZE_BYTES+1, temp_ram.array, q.number_w); temp_ram.array[0] = 0; }
        COPYN(QSIZE_BYTES+1, r_i[i+1].number_w, temp_ram.array);       
        debugValue("r_i", r_i[i+1].number, QSIZE_BYTES);
@@ -868,22 +955,106 @@ void challengeM(void) {
     // Send a back
     COPYN(QSIZE_BYTES, apdu_data.number_q_size, a.number);
     // clear w_i
-    CLEARN((QSIZE_BYTES+1)*(MAX_ATTR+1), w_i[0].number_w);
+    CLEARN((QSIZE_BYTES+1)*(attrCount+1), w_ram.w_i[0].number_w);
+    debugLeave("challengeM");
+}
+
+/**
+  * Move the attribute values down over the gaps left by replaced ones,
+  * keeping their order in the heap
+  */
+void compactAttributes(void) {
+    unsigned int used = 0;
+    int i, next;
+    do {
+       // the value closest above the compacted part
+       next = -1;
+       for(i = 0; i < MAX_ATTR; i++) {
+          if(attrSize[i] && attrOffset[i] >= used && (next < 0 || attrOffset[i] < attrOffset[next])) next = i;
+       }
+       if(next >= 0) {
+          if(attrOffset[next] != used) {
+             debugPrimitive("Move", attrSize[next], 0);
+             memmove(attrHeap + used, attrHeap + attrOffset[next], attrSize[next]);
+             attrOffset[next] = used;
+          }
+          used += attrSize[next];
+       }
+    } while(next >= 0);
+    attrHeapUsed = used;
+}
+
+/**
+  * Store the value of attribute index at the end of the heap, returns 0
+  * if it does not fit even after compaction
+  */
+int setAttribute(int index, unsigned char *value, int length) {
+    unsigned int live = length;
+    int i;
+    for(i = 0; i < MAX_ATTR; i++) {
+       if(i != index) live += attrSize[i];
+    }
+    if(live > ATTR_HEAP_SIZE) return 0;
+    attrSize[index] = 0;
+    if(attrHeapUsed + length > ATTR_HEAP_SIZE) compactAttributes();
+    memcpy(attrHeap + attrHeapUsed, value, length);
+    attrOffset[index] = attrHeapUsed;
+    attrSize[index] = length;
+    attrHeapUsed += length;
+    return 1;
+}
+
+/**
+  * Take length bytes off the 4 byte big endian counter, returns -1 if it
+  * holds less (and leaves it alone), 0 when it reaches zero and 1 otherwise
+  */
+int countDown(unsigned char *counter, int length) {
+    unsigned int low = (counter[2] << 8) | counter[3];
+    if (low < length) {
+       if (counter[0] == 0 && counter[1] == 0) return -1;
+       if (counter[1]-- == 0) counter[0]--;
+    }
+    low = (low - length) & 0xFFFF;
+    counter[2] = (low >> 8) & 0xFF;
+    counter[3] = low & 0xFF;
+    return (counter[0] | counter[1] | counter[2] | counter[3]) != 0;
 }
 
 /**
     Index is already counted from 0..n-1
   */
 int discloseAi(int index) {
-    int i = 0;
-	memcpy(apdu_data.raw_data, A_i[index].attr_val, A_i[index].attr_size);
-	return A_i[index].attr_size;
+	if (attrOffset[index] == ATTR_STREAMED) ExitSW(ERR_DATA_NOT_FOUND);
+	debugPrimitive("Copy", attrSize[index], 0);
+	memcpy(apdu_data.raw_data, attrHeap + attrOffset[index], attrSize[index]);
+	return attrSize[index];
 }
 
 void returnRi(int index) {
     COPYN(QSIZE_BYTES, apdu_data.number_q_size, r_i[index].number);
 }
 
+/**
+  * r_0 followed by the r_i of the undisclosed attributes in ascending
+  * order, returns the length or 0 if they do not fit in one response
+  */
+int returnAllRi(void) {
+    int i;
+    int offset = QSIZE_BYTES;
+    for(i = 0; i < attrCount; i++) {
+       if(!UD[i]) offset += QSIZE_BYTES;
+    }
+    if(offset > sizeof(apdu_data.raw_data)) return 0;
+    COPYN(QSIZE_BYTES, apdu_data.raw_data, r_i[0].number);
+    offset = QSIZE_BYTES;
+    for(i = 0; i < attrCount; i++) {
+       if(UD[i]) continue; // i is in D, not interested
+       COPYN(QSIZE_BYTES, apdu_data.raw_data+offset, r_i[i+1].number);
+       offset += QSIZE_BYTES;
+    }
+    return offset;
+}
+
 /**
      index == 0 -> h (P size)
      index == 1 -> sigma_z_prime (P size)
@@ -910,7 +1081,10 @@ void main(void)
   //int j = 0;
   if (CLA != UPROVE_CLA)
     ExitSW(ERR_WRONGCLASS);
-  
+
+  debugCommand(INS, P1, P2, Lc);
+  if (INS != CMD_INIT_STREAM_ATTRVAL) streamIndex = 0;
+
   switch (INS)
     {
 
@@ -943,6 +1117,7 @@ void main(void)
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (P1 != 0) ExitSW(ERR_WRONGP1P2);
       if (P2 != 0) ExitSW(ERR_WRONGP1P2);
+      debugPrimitive("Copy", UID_p_length, 0);
       memcpy(apdu_data.raw_data, UID_p, UID_p_length);
       ExitLa(UID_p_length);
       break;
@@ -954,20 +1129,21 @@ void main(void)
           case 0: // p
             if (Lc != PSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
             COPYN(PSIZE_BYTES, p.number, apdu_data.number_p_size);
+            group = GROUP_CUSTOM;
 		    debugValue("p", p.number, PSIZE_BYTES);
             break;
           case 1: // q
             if (Lc != QSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
             COPYN(QSIZE_BYTES, q.number, apdu_data.number_q_size);
-            COPYN(QSIZE_BYTES, q_minus_2.number, apdu_data.number_q_size);
-            // FIXME This is not bulletproof:
-            q_minus_2.number[QSIZE_BYTES - 1] = q_minus_2.number[QSIZE_BYTES - 1] - 2;
+            minus2(QSIZE_BYTES, q_minus_2.number, q.number);
+            group = GROUP_CUSTOM;
 		    debugValue("q", q.number, QSIZE_BYTES);
 		    debugValue("q-2", q_minus_2.number, QSIZE_BYTES);
             break;
           case 2: // g
             if (Lc != PSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
             COPYN(PSIZE_BYTES, g.number, apdu_data.number_p_size);
+            group = GROUP_CUSTOM;
 		    debugValue("g", g.number, PSIZE_BYTES);
             break;
           default:
@@ -992,6 +1168,10 @@ void main(void)
           case 2: // g
             COPYN(PSIZE_BYTES, apdu_data.number_p_size, g.number);
             break;
+          case 3: // group identifier
+            apdu_data.raw_data[0] = group;
+            i = 1;
+            break;
           default:
             ExitSW(ERR_WRONGP1P2);
             break;
@@ -1014,7 +1194,7 @@ void main(void)
 
     case CMD_INIT_SET_PUBKEY:
       if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
-      if (P2 != MAX_ATTR + 2) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 2) ExitSW(ERR_WRONGP1P2);
       if (P1 >= P2) ExitSW(ERR_WRONGP1P2);
       if (Lc != PSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
       COPYN(PSIZE_BYTES, g_i[P1].number, apdu_data.number_p_size);
@@ -1025,7 +1205,7 @@ void main(void)
 
     case CMD_INIT_GET_PUBKEY:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
-      if (P2 != MAX_ATTR + 2) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 2) ExitSW(ERR_WRONGP1P2);
       if (P1 >= P2) ExitSW(ERR_WRONGP1P2);
       COPYN(PSIZE_BYTES, apdu_data.number_p_size, g_i[P1].number);
       ExitLa(PSIZE_BYTES);
@@ -1035,9 +1215,9 @@ void main(void)
       if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
       if (P1 != 0) ExitSW(ERR_WRONGP1P2);
       if (P2 != 0) ExitSW(ERR_WRONGP1P2);
-      if (Lc != MAX_ATTR) ExitSW(ERR_WRONGLENGTH);
-      COPYN(MAX_ATTR, e_i, apdu_data.raw_data);
-      debugValue("e_i", e_i, MAX_ATTR);
+      if (Lc != attrCount) ExitSW(ERR_WRONGLENGTH);
+      COPYN(attrCount, e_i, apdu_data.raw_data);
+      debugValue("e_i", e_i, attrCount);
       ExitLa(0);
       break;
 
@@ -1045,13 +1225,14 @@ void main(void)
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (P1 != 0) ExitSW(ERR_WRONGP1P2);
       if (P2 != 0) ExitSW(ERR_WRONGP1P2);
-      COPYN(MAX_ATTR, apdu_data.raw_data, e_i);
-      ExitLa(MAX_ATTR);
+      debugPrimitive("Copy", attrCount, 0);
+      COPYN(attrCount, apdu_data.raw_data, e_i);
+      ExitLa(attrCount);
       break;
 
     case CMD_INIT_SET_ISSUEVAL:
       if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
-      if (P2 != MAX_ATTR + 2) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 2) ExitSW(ERR_WRONGP1P2);
       if (P1 >= P2) ExitSW(ERR_WRONGP1P2);
       if (Lc != PSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
       COPYN(PSIZE_BYTES, z_i[P1].number, apdu_data.number_p_size);
@@ -1062,7 +1243,7 @@ void main(void)
 
     case CMD_INIT_GET_ISSUEVAL:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
-      if (P2 != MAX_ATTR + 2) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 2) ExitSW(ERR_WRONGP1P2);
       if (P1 >= P2) ExitSW(ERR_WRONGP1P2);
       COPYN(PSIZE_BYTES, apdu_data.number_p_size, z_i[P1].number);
       ExitLa(PSIZE_BYTES);
@@ -1085,18 +1266,17 @@ void main(void)
 
     case CMD_INIT_SET_RAWATTRVAL:
       if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
-      if (P2 != MAX_ATTR) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount) ExitSW(ERR_WRONGP1P2);
       if (P1 == 0) ExitSW(ERR_WRONGP1P2); // a_0 is not valid
       if (P1 > P2) ExitSW(ERR_WRONGP1P2);
-	  COPYN(MAX_ATTR_SIZE, A_i[P1 - 1].attr_val, apdu_data.raw_data);
-	  A_i[P1 - 1].attr_size = Lc;
+      if (!e_i[P1-1] && Lc > QSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
+      if (!setAttribute(P1 - 1, apdu_data.raw_data, Lc)) ExitSW(ERR_NOT_ENOUGH_MEMORY);
       if (e_i[P1-1]) {
          // Hash the attribute
          i = putNumberIntoArray(Lc, apdu_data.raw_data, tempArray);
-         SHA1(i, x_i[P1-1].number, tempArray);
+         Hash(i, x_i[P1-1].number, tempArray);
          x_i[P1-1].number_w[0] = 0;
       }else{
-         if(Lc > QSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
          for(i=0; i<QSIZE_BYTES+1; i++) {
            x_i[P1-1].number_w[i] = 0;
          }
@@ -1106,14 +1286,56 @@ void main(void)
       ExitLa(0);
       break;
 
+    case CMD_INIT_STREAM_ATTRVAL:
+      if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
+      if (P2 != attrCount) ExitSW(ERR_WRONGP1P2);
+      if (P1 > P2) ExitSW(ERR_WRONGP1P2);
+      if (P1 != 0) {
+         // P1 = i starts attribute i, the data begins with the 4 byte value length
+         if (!e_i[P1-1]) ExitSW(ERR_WRONGDATA);
+         if (Lc < 4) ExitSW(ERR_WRONGLENGTH);
+         // putNumberIntoArray() would strip the leading zeros of a value of
+         // these lengths before hashing, which the chunks cannot undo
+         if (apdu_data.raw_data[0] == 0 && apdu_data.raw_data[1] == 0 && apdu_data.raw_data[2] == 0 &&
+             (apdu_data.raw_data[3] == QSIZE_BYTES || apdu_data.raw_data[3] == PSIZE_BYTES)) {
+            ExitSW(ERR_WRONGLENGTH);
+         }
+         COPYN(4, temp_ram.stream.left, apdu_data.raw_data);
+         CLEARN(SHA1_BYTES, temp_ram.stream.state);
+         CLEARN(4, temp_ram.stream.count);
+         streamIndex = P1;
+         i = countDown(temp_ram.stream.left, Lc - 4);
+      } else {
+         // P1 = 0 continues the upload in progress
+         if (streamIndex == 0) ExitSW(ERR_WRONGP1P2);
+         i = countDown(temp_ram.stream.left, Lc);
+      }
+      // All chunks but the last are whole SHA-1 blocks, errors end the upload
+      if (i < 0 || (i > 0 && Lc % SHA1_BLOCK_BYTES)) {
+         streamIndex = 0;
+         ExitSW(ERR_WRONGLENGTH);
+      }
+      if (i > 0) {
+         HashIV(Lc, t.number, apdu_data.raw_data, temp_ram.stream.state, temp_ram.stream.count);
+         ExitLa(0);
+      }
+      HashIV(Lc, x_i[streamIndex-1].number, apdu_data.raw_data, temp_ram.stream.state, temp_ram.stream.count);
+      x_i[streamIndex-1].number_w[0] = 0;
+      // Only x_i is kept, the value is disclosed by the host
+      attrSize[streamIndex-1] = 0;
+      attrOffset[streamIndex-1] = ATTR_STREAMED;
+      debugValue("x_i", x_i[streamIndex-1].number, QSIZE_BYTES);
+      streamIndex = 0;
+      ExitLa(0);
+      break;
+
     case CMD_INIT_GET_RAWATTRVAL:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (!testMode) ExitSW(ERR_INS_NOT_SUPPORTED);
-      if (P2 != MAX_ATTR) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount) ExitSW(ERR_WRONGP1P2);
       if (P1 == 0) ExitSW(ERR_WRONGP1P2); // a_0 is not valid
       if (P1 > P2) ExitSW(ERR_WRONGP1P2);
-	  memcpy(apdu_data.raw_data, A_i[P1 - 1].attr_val, A_i[P1-1].attr_size);
-      ExitLa(A_i[P1 - 1].attr_size);
+      ExitLa(discloseAi(P1 - 1));
       break;
 
     case CMD_INIT_SET_TI:
@@ -1149,7 +1371,7 @@ void main(void)
     case CMD_INIT_SET_ATTRVAL:
       if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
       if (!testMode) ExitSW(ERR_INS_NOT_SUPPORTED);
-      if (P2 != MAX_ATTR + 1) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 1) ExitSW(ERR_WRONGP1P2);
       if (P1 == 0) ExitSW(ERR_WRONGP1P2); // x_0 is not valid
       if (P1 >  P2) ExitSW(ERR_WRONGP1P2);
       if (Lc != QSIZE_BYTES) ExitSW(ERR_WRONGLENGTH);
@@ -1162,18 +1384,41 @@ void main(void)
     case CMD_INIT_GET_ATTRVAL:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (!testMode) ExitSW(ERR_INS_NOT_SUPPORTED);
-      if (P2 != MAX_ATTR + 1) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount + 1) ExitSW(ERR_WRONGP1P2);
       if (P1 == 0) ExitSW(ERR_WRONGP1P2); // x_0 is not valid
       if (P1 > P2) ExitSW(ERR_WRONGP1P2);
       COPYN(QSIZE_BYTES, apdu_data.number_q_size, x_i[P1-1].number);
       ExitLa(QSIZE_BYTES);
       break;
 
+    case CMD_INIT_SET_ATTRCOUNT:
+      if (!CheckCase(3)) ExitSW(ERR_WRONGCLASS);
+      if (P2 != 0) ExitSW(ERR_WRONGP1P2);
+      if (P1 != 0) ExitSW(ERR_WRONGP1P2);
+      if (Lc != 1) ExitSW(ERR_WRONGLENGTH);
+      if (apdu_data.raw_data[0] == 0) ExitSW(ERR_WRONGDATA);
+      if (apdu_data.raw_data[0] > MAX_ATTR) ExitSW(ERR_WRONGDATA);
+      // g_t, z_t and x_t follow attribute n, so they move along with it
+      if (apdu_data.raw_data[0] != attrCount) {
+        debugPrimitive("Move", 2 * sizeof(g_i[0]) + sizeof(x_i[0]), 0);
+        g_i[apdu_data.raw_data[0] + 1] = g_i[attrCount + 1];
+        z_i[apdu_data.raw_data[0] + 1] = z_i[attrCount + 1];
+        x_i[apdu_data.raw_data[0]] = x_i[attrCount];
+      }
+      attrCount = apdu_data.raw_data[0];
+      // Drop the values of the attributes beyond n
+      for (i = attrCount; i < MAX_ATTR; i++) {
+        attrSize[i] = 0;
+      }
+      debugValue("n", &attrCount, 1);
+      ExitLa(0);
+      break;
+
     case CMD_INIT_GET_ATTRCOUNT:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (P2 != 0) ExitSW(ERR_WRONGP1P2);
       if (P1 != 0) ExitSW(ERR_WRONGP1P2); 
-      apdu_data.raw_data[0] = MAX_ATTR;
+      apdu_data.raw_data[0] = attrCount;
       ExitLa(1);
       break;
 
@@ -1234,7 +1479,7 @@ void main(void)
       if (P1 != 00) ExitSW(ERR_WRONGP1P2);
       if (P2 != 00) ExitSW(ERR_WRONGP1P2);
       if(CheckCase(3)) {	  
-	    if (Lc > MAX_ATTR) ExitSW(ERR_WRONGLENGTH);
+	    if (Lc > attrCount) ExitSW(ERR_WRONGLENGTH);
 	    selectD(Lc);
 	  }else{
 	    selectD(0);
@@ -1254,17 +1499,23 @@ void main(void)
     case CMD_PRESENT_DISCLOSE_AI:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
       if (P1 == 0) ExitSW(ERR_WRONGP1P2);
-      if (P1 > MAX_ATTR) ExitSW(ERR_WRONGP1P2);
+      if (P1 > attrCount) ExitSW(ERR_WRONGP1P2);
       if (!UD[P1-1]) ExitSW(ERR_WRONGP1P2);
-      if (P2 != MAX_ATTR) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount) ExitSW(ERR_WRONGP1P2);
       ExitLa(discloseAi(P1-1));
       break;
 
     case CMD_PRESENT_RETURN_RI:
       if (!CheckCase(1)) ExitSW(ERR_WRONGCLASS);
-      if (P1 > MAX_ATTR) ExitSW(ERR_WRONGP1P2);
+      if (P1 == RETURN_RI_ALL) {
+        if (P2 != attrCount+1) ExitSW(ERR_WRONGP1P2);
+        i = returnAllRi();
+        if (i == 0) ExitSW(ERR_WRONGLENGTH);
+        ExitLa(i);
+      }
+      if (P1 > attrCount) ExitSW(ERR_WRONGP1P2);
       if (P1 != 0 && UD[P1-1]) ExitSW(ERR_WRONGP1P2);
-      if (P2 != MAX_ATTR+1) ExitSW(ERR_WRONGP1P2);
+      if (P2 != attrCount+1) ExitSW(ERR_WRONGP1P2);
       returnRi(P1);
       ExitLa(QSIZE_BYTES);
       break;
@@ -1293,6 +1544,7 @@ void main(void)
          CLEARN(PSIZE_BYTES, g.number);
          CLEARN(QSIZE_BYTES, q.number);
          CLEARN(QSIZE_BYTES, q_minus_2.number);
+         group = GROUP_CUSTOM;
          CLEARN((MAX_ATTR+2)*(PSIZE_BYTES+1), g_i[0].number_w);
          CLEARN((MAX_ATTR+2)*(PSIZE_BYTES+1), z_i[0].number_w);
          CLEARN((MAX_ATTR+1)*(QSIZE_BYTES+1), x_i[0].number_w);
@@ -1309,14 +1561,11 @@ void main(void)
          CLEARN(MAX_ATTR, e_i);
 		 memset(UID_p, 0, UID_p_length);
 		 UID_p_length = 0;
-		 for(i=0;i<MAX_ATTR;i++) {
-		     A_i[i].attr_size = 0;			
-		 }
-		 CLEARN(MAX_ATTR_SIZE, A_i[0].attr_val);
-		 CLEARN(MAX_ATTR_SIZE, A_i[1].attr_val);
-		 CLEARN(MAX_ATTR_SIZE, A_i[2].attr_val);
-		 CLEARN(MAX_ATTR_SIZE, A_i[3].attr_val);
-		 CLEARN(MAX_ATTR_SIZE, A_i[4].attr_val);
+		 memset(attrHeap, 0, attrHeapUsed);
+		 CLEARN(MAX_ATTR, attrSize);
+		 memset(attrOffset, 0, sizeof(attrOffset));
+		 attrHeapUsed = 0;
+		 attrCount = MAX_ATTR;
       }else{
          testMode = P1;
       }
@@ -0,0 +1,361 @@
+/**
+ * hostcard.c
+ *
+ * Host build of the applet for tests without hsim: src/uprove.c is
+ * compiled against the stand-in MULTOS headers in this directory, with
+ * the primitives implemented on OpenSSL.  The applet keeps its card
+ * memory layout, only the primitives and the APDU transport differ.
+ *
+ * Usage:
+ *   uprove.host script       run the hex APDUs of a script such as
+ *                            test/testscript.txt, printing "> command"
+ *                            and "< data SW" lines
+ *   uprove.host - [perso]    the transport of tools/card.py: one hex APDU
+ *                            per line on stdin, answered with hex data+SW,
+ *                            after silently running the perso script
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <openssl/bn.h>
+#include <openssl/sha.h>
+
+#include "melasm.h"
+
+unsigned char CLA, INS, P1, P2, Lc, La;
+
+#define main applet_main
+#include "uprove.c"
+#undef main
+
+/********************************************************************/
+/* APDU transport                                                   */
+/********************************************************************/
+
+static int apduCase;
+static jmp_buf exitApplet;
+static int exitSW, exitLa;
+
+int host_checkcase(int c) {
+  return c == apduCase;
+}
+
+void host_exit(int sw, int la) {
+  exitSW = sw;
+  exitLa = la;
+  longjmp(exitApplet, 1);
+}
+
+/********************************************************************/
+/* Block arithmetic                                                 */
+/********************************************************************/
+
+static BN_CTX *ctx;
+
+static BIGNUM *toBN(const unsigned char *x, int length) {
+  return BN_bin2bn(x, length, NULL);
+}
+
+void host_copyn(int length, void *dest, const void *src) {
+  memmove(dest, src, length);
+}
+
+void host_clearn(int length, void *dest) {
+  memset(dest, 0, length);
+}
+
+void host_addn(int length, unsigned char *result, const unsigned char *a, const unsigned char *b) {
+  int i, carry = 0;
+  for (i = length - 1; i >= 0; i--) {
+    int sum = a[i] + b[i] + carry;
+    carry = sum >> 8;
+    result[i] = sum & 0xFF;
+  }
+}
+
+void host_subn(int length, unsigned char *result, const unsigned char *a, const unsigned char *b) {
+  int i, borrow = 0;
+  for (i = length - 1; i >= 0; i--) {
+    int diff = a[i] - b[i] - borrow;
+    borrow = diff < 0;
+    result[i] = diff & 0xFF;
+  }
+}
+
+void host_modred(int length, int modulusLength, unsigned char *op, const unsigned char *modulus) {
+  BIGNUM *a = toBN(op, length), *m = toBN(modulus, modulusLength);
+  BN_mod(a, a, m, ctx);
+  BN_bn2binpad(a, op, length);
+  BN_free(a);
+  BN_free(m);
+}
+
+/********************************************************************/
+/* Hashing and random numbers                                       */
+/********************************************************************/
+
+void host_sha1(int length, unsigned char *digest, const unsigned char *message) {
+  SHA_CTX sha; // SHA1() is the applet's macro here
+  SHA1_Init(&sha);
+  SHA1_Update(&sha, message, length);
+  SHA1_Final(digest, &sha);
+}
+
+void host_random(unsigned char *dest) {
+  int i;
+  for (i = 0; i < 8; i++) dest[i] = rand();
+}
+
+static void putWord(unsigned char *dest, unsigned long word) {
+  dest[0] = word >> 24; dest[1] = word >> 16; dest[2] = word >> 8; dest[3] = word;
+}
+
+static unsigned long getWord(const unsigned char *src) {
+  return ((unsigned long)src[0] << 24) | ((unsigned long)src[1] << 16) | (src[2] << 8) | src[3];
+}
+
+/**
+ * PRIM_SECURE_HASH_IV as described in MULTOS.h: continue the hash of
+ * count (a multiple of 64) bytes with state, over the remainder of the
+ * previous call followed by message.  Returns the digest of everything
+ * hashed so far, updates state and count to the last full block and
+ * leaves the new remainder on the stack.
+ */
+static unsigned char remainder[64];
+
+static void secureHashIV(int messageLength, int hashLength, unsigned char *hash,
+    unsigned char *message, unsigned char *state, unsigned char *count,
+    int remainderLength, unsigned char *previous) {
+  SHA_CTX sha, last;
+  unsigned char data[2048 + 64];
+  unsigned long hashed = getWord(count);
+  int length, blocks;
+
+  if (hashLength != SHA1_BYTES) {
+    fprintf(stderr, "PRIM_SECURE_HASH_IV: only SHA-1 is supported\n");
+    exit(2);
+  }
+  SHA1_Init(&sha);
+  if (hashed == 0) {
+    remainderLength = 0;
+  } else {
+    if (hashed % 64 != 0) {
+      fprintf(stderr, "PRIM_SECURE_HASH_IV: count is not a multiple of 64\n");
+      exit(2);
+    }
+    sha.h0 = getWord(state); sha.h1 = getWord(state + 4); sha.h2 = getWord(state + 8);
+    sha.h3 = getWord(state + 12); sha.h4 = getWord(state + 16);
+    sha.Nl = (hashed * 8) & 0xFFFFFFFFUL;
+    sha.Nh = 0;
+  }
+  memcpy(data, previous, remainderLength);
+  memcpy(data + remainderLength, message, messageLength);
+  length = remainderLength + messageLength;
+  blocks = length - length % 64;
+  SHA1_Update(&sha, data, blocks);
+
+  putWord(state, sha.h0); putWord(state + 4, sha.h1); putWord(state + 8, sha.h2);
+  putWord(state + 12, sha.h3); putWord(state + 16, sha.h4);
+  putWord(count, hashed + blocks);
+  memcpy(remainder, data + blocks, length - blocks);
+  last = sha;
+  SHA1_Update(&last, remainder, length - blocks);
+  SHA1_Final(hash, &last);
+  host_push(length - blocks);
+  host_push((intptr_t)remainder);
+}
+
+/********************************************************************/
+/* Primitives                                                       */
+/********************************************************************/
+
+static intptr_t stack[32];
+static int top;
+
+void host_push(intptr_t value) {
+  stack[top++] = value;
+}
+
+static intptr_t pop(void) {
+  return stack[--top];
+}
+
+static void modularExponentiation(void) {
+  unsigned char *result = (void *)pop(), *base = (void *)pop(),
+    *modulus = (void *)pop(), *exponent = (void *)pop();
+  int modulusLength = pop(), exponentLength = pop();
+  BIGNUM *e = toBN(exponent, exponentLength), *m = toBN(modulus, modulusLength),
+    *b = toBN(base, modulusLength), *r = BN_new();
+  BN_mod_exp(r, b, e, m, ctx);
+  BN_bn2binpad(r, result, modulusLength);
+  BN_free(e); BN_free(m); BN_free(b); BN_free(r);
+}
+
+static void modularMultiplication(void) {
+  unsigned char *modulus = (void *)pop(), *right = (void *)pop(), *left = (void *)pop();
+  int length = pop();
+  BIGNUM *l = toBN(left, length), *r = toBN(right, length), *m = toBN(modulus, length);
+  BN_mod_mul(l, l, r, m, ctx);
+  BN_bn2binpad(l, left, length);
+  BN_free(l); BN_free(r); BN_free(m);
+}
+
+void host_code(int op, ...) {
+  va_list ap;
+  va_start(ap, op);
+  if (op == PRIM) {
+    int primitive = va_arg(ap, int);
+    switch (primitive) {
+      case PRIM_MODULAR_MULTIPLICATION:
+        modularMultiplication();
+        break;
+      case PRIM_MODULAR_EXPONENTIATION:
+      case PRIM_RSA_VERIFY:
+        modularExponentiation();
+        break;
+      case PRIM_SHA1: {
+        unsigned char *message = (void *)pop(), *digest = (void *)pop();
+        host_sha1(pop(), digest, message);
+        break;
+      }
+      case PRIM_SECURE_HASH_IV: {
+        unsigned char *previous = (void *)pop();
+        int remainderLength = pop();
+        unsigned char *count = (void *)pop(), *state = (void *)pop();
+        unsigned char *message = (void *)pop(), *hash = (void *)pop();
+        int hashLength = pop(), messageLength = pop();
+        secureHashIV(messageLength, hashLength, hash, message, state, count,
+                     remainderLength, previous);
+        break;
+      }
+      default:
+        fprintf(stderr, "unsupported primitive %02X\n", primitive);
+        exit(2);
+    }
+  } else if (op == POPN) {
+    top -= va_arg(ap, int) / 2; // two byte stack entries
+  } else if (op == STORE) {
+    void *dest = va_arg(ap, void *);
+    int length = va_arg(ap, int);
+    intptr_t value = pop();
+    if (length == 2) {
+      *(unsigned int *)dest = (unsigned int)value;
+    } else if (length == 1) {
+      *(unsigned char *)dest = (unsigned char)value;
+    } else {
+      fprintf(stderr, "unsupported STORE of %d bytes\n", length);
+      exit(2);
+    }
+  } else {
+    fprintf(stderr, "unsupported instruction %d\n", op);
+    exit(2);
+  }
+  va_end(ap);
+}
+
+/********************************************************************/
+/* Command loop                                                     */
+/********************************************************************/
+
+static int hexValue(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+/**
+ * The APDU on a line of hex digits, lines with anything else are comments.
+ * Returns the APDU length or 0.
+ */
+static int parseAPDU(char *line, unsigned char *apdu) {
+  int i, length = strcspn(line, "\r\n \t");
+  line[length] = 0;
+  if (length < 8 || length % 2 != 0) return 0;
+  if (strspn(line, "0123456789abcdefABCDEF") != length) return 0;
+  for (i = 0; i < length; i += 2) {
+    apdu[i / 2] = hexValue(line[i]) * 16 + hexValue(line[i + 1]);
+  }
+  return length / 2;
+}
+
+static void processAPDU(const unsigned char *apdu, int length) {
+  CLA = apdu[0]; INS = apdu[1]; P1 = apdu[2]; P2 = apdu[3];
+  Lc = 0; La = 0;
+  if (length == 4) {
+    apduCase = 1;
+  } else if (length == 5) {
+    apduCase = 2;
+    La = apdu[4];
+  } else {
+    Lc = apdu[4];
+    apduCase = length == 5 + Lc ? 3 : 4;
+    memcpy(apdu_data.raw_data, apdu + 5, Lc);
+  }
+  if (INS == 0xA4) { // SELECT, the applet is always selected
+    exitSW = 0x9000;
+    exitLa = 0;
+    return;
+  }
+  if (!setjmp(exitApplet)) {
+    applet_main();
+    exitSW = 0x6F00; // the applet returned without ExitSW() or ExitLa()
+    exitLa = 0;
+  }
+}
+
+int main(int argc, char **argv) {
+  int transport, quiet = 0, length, i;
+  char line[4096];
+  unsigned char apdu[5 + 256];
+  FILE *in;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s script | - [perso]\n", argv[0]);
+    return 1;
+  }
+  transport = !strcmp(argv[1], "-");
+  in = transport ? stdin : fopen(argv[1], "r");
+  if (transport && argc > 2) {
+    in = fopen(argv[2], "r");
+    quiet = 1;
+  }
+  if (in == NULL) {
+    perror(argv[argc - 1]);
+    return 1;
+  }
+  ctx = BN_CTX_new();
+  srand(transport ? time(NULL) : 1);
+
+  for (;;) {
+    if (!fgets(line, sizeof(line), in)) {
+      if (!quiet) break;
+      fclose(in);
+      in = stdin;
+      quiet = 0;
+      continue;
+    }
+    if (!(length = parseAPDU(line, apdu))) continue;
+    processAPDU(apdu, length);
+    if (quiet) continue;
+    if (!transport) printf("> %s\n< ", line);
+    for (i = 0; i < exitLa; i++) printf("%02x", apdu_data.raw_data[i]);
+    printf(transport ? "%04X\n" : " %04X\n", exitSW);
+    fflush(stdout);
+  }
+  return 0;
+}
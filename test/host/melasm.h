@@ -0,0 +1,36 @@
+/**
+ * melasm.h
+ *
+ * Host stand-in for the MEL assembler interface used by include/math.h:
+ * the arguments of a primitive are pushed on a stack and the primitive
+ * is run by hostcard.c.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MELASM_H
+#define __MELASM_H
+
+#include <stdint.h>
+
+enum { PRIM = 1000, POPN, STORE };
+
+void host_push(intptr_t value);
+void host_code(int op, ...);
+
+#define __push(x) host_push((intptr_t)(x))
+#define __code(...) host_code(__VA_ARGS__)
+#define __typechk(type, x) ((type)(x))
+
+#endif // __MELASM_H
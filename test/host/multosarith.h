@@ -0,0 +1,37 @@
+/**
+ * multosarith.h
+ *
+ * Host stand-in for the MULTOS block arithmetic used by the applet.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MULTOSARITH_H
+#define __MULTOSARITH_H
+
+void host_copyn(int length, void *dest, const void *src);
+void host_clearn(int length, void *dest);
+void host_addn(int length, unsigned char *result, const unsigned char *a, const unsigned char *b);
+void host_subn(int length, unsigned char *result, const unsigned char *a, const unsigned char *b);
+void host_modred(int length, int modulusLength, unsigned char *op, const unsigned char *modulus);
+
+#define COPYN(n, d, s) host_copyn(n, d, s)
+#define CLEARN(n, d) host_clearn(n, d)
+#define ADDN(n, r, a, b) host_addn(n, r, a, b)
+#define SUBN(n, r, a, b) host_subn(n, r, a, b)
+#define ASSIGN_ADDN(n, a, b) host_addn(n, a, a, b)
+#define ASSIGN_SUBN(n, a, b) host_subn(n, a, a, b)
+#define ModularReduction(ol, ml, op, m) host_modred(ol, ml, op, m)
+
+#endif // __MULTOSARITH_H
@@ -0,0 +1,33 @@
+/**
+ * multoscomms.h
+ *
+ * Host stand-in for the MULTOS APDU interface, ExitSW() and ExitLa()
+ * return to the command loop in hostcard.c.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MULTOSCOMMS_H
+#define __MULTOSCOMMS_H
+
+extern unsigned char CLA, INS, P1, P2, Lc, La;
+
+int host_checkcase(int apduCase);
+void host_exit(int sw, int la);
+
+#define CheckCase(c) host_checkcase(c)
+#define ExitSW(sw) host_exit(sw, 0)
+#define ExitLa(la) host_exit(0x9000, la)
+
+#endif // __MULTOSCOMMS_H
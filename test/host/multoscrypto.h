@@ -0,0 +1,29 @@
+/**
+ * multoscrypto.h
+ *
+ * Host stand-in for the MULTOS hash and random number primitives.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MULTOSCRYPTO_H
+#define __MULTOSCRYPTO_H
+
+void host_sha1(int length, unsigned char *digest, const unsigned char *message);
+void host_random(unsigned char *dest);
+
+#define SHA1(len, d, s) host_sha1(len, d, s)
+#define GetRandomNumber(d) host_random(d)
+
+#endif // __MULTOSCRYPTO_H
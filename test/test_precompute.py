@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+#
+# test_precompute.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+The precomputation helpers in tools/uprove.py (batch_inverse, FixedBase,
+fixed_multi_exp, multi_exp and Precomputation) against plain pow() and
+against the values of test/testvectors.txt.
+
+  python3 test/test_precompute.py
+"""
+
+import os
+import random
+import sys
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', 'tools'))
+
+from uprove import *
+
+class PrecomputeTest(unittest.TestCase):
+  @classmethod
+  def setUpClass(cls):
+    cls.v = v = read_vectors(os.path.join(HERE, 'testvectors.txt'))
+    cls.params = IssuerParameters.from_vectors(v)
+    cls.rng = random.Random(1)
+
+  def value(self, key):
+    return int(self.v[key], 16)
+
+  def test_batch_inverse(self):
+    q = self.params.q
+    for k in (1, 2, 3, 16):
+      values = [self.rng.randrange(1, q) for _ in range(k)]
+      self.assertEqual(batch_inverse(values, q), [pow(x, q - 2, q) for x in values], k)
+    self.assertEqual(batch_inverse([self.value('alpha')], q), [self.value('alphaInverse')])
+    self.assertEqual(batch_inverse([1, q - 1], q), [1, q - 1])
+
+  def test_fixed_base(self):
+    p, q = self.params.p, self.params.q
+    for width in (1, 4, 8):
+      table = FixedBase(self.params.g, p, width=width)
+      for e in (0, 1, 2, q - 1, (1 << (QSIZE_BYTES * 8)) - 1, self.rng.randrange(q)):
+        self.assertEqual(fixed_multi_exp([(table, e)], p), pow(self.params.g, e, p), (width, e))
+
+  def test_fixed_multi_exp(self):
+    p, q = self.params.p, self.params.q
+    bases = [self.params.g] + self.params.g_i
+    pairs = [(b, self.rng.randrange(q)) for b in bases]
+    expected = 1
+    for (b, e) in pairs:
+      expected = expected * pow(b, e, p) % p
+    self.assertEqual(fixed_multi_exp([(FixedBase(b, p), e) for (b, e) in pairs], p), expected)
+
+  def test_multi_exp(self):
+    p, q = self.params.p, self.params.q
+    for k in (1, 2, 7):
+      for width in (1, 4, 5):
+        pairs = [(self.rng.randrange(2, p), self.rng.randrange(q)) for _ in range(k)]
+        expected = 1
+        for (b, e) in pairs:
+          expected = expected * pow(b, e, p) % p
+        self.assertEqual(multi_exp(pairs, p, width), expected, (k, width))
+    # zero and one exponents, and exponents of different lengths
+    pairs = [(self.params.g, 0), (self.params.g_i[0], 1), (self.params.g_i[1], q - 1)]
+    expected = self.params.g_i[0] * pow(self.params.g_i[1], q - 1, p) % p
+    self.assertEqual(multi_exp(pairs, p), expected)
+    self.assertEqual(multi_exp([(self.params.g, 0)], p), 1)
+
+  def test_precomputation_vectors(self):
+    params, p = self.params, self.params.p
+    bases = Bases(params, self.value('gamma'), self.value('sigma_z'))
+    pre = Precomputation(params, bases, bytes.fromhex(self.v['PI']), self.value('alpha'),
+                         self.value('alphaInverse'), self.value('beta1'), self.value('beta2'))
+    self.assertEqual(pre.h, self.value('h'))
+    self.assertEqual(pre.sigma_z, self.value('sigma_z_prime'))
+    self.assertEqual(pre.alpha * pre.alpha_inverse % params.q, 1)
+    # sigmaACommittment() and sigmaBCommittment() on top of the precomputation
+    sigma_a_prime = pre.t_a * self.value('sigma_a') % p
+    sigma_b_prime = pre.t_b * pow(self.value('sigma_b'), pre.alpha, p) % p
+    self.assertEqual(sigma_a_prime, self.value('sigma_a_prime'))
+    self.assertEqual(sigma_b_prime, self.value('sigma_b_prime'))
+    self.assertEqual(finish_sigma_c(params, pre.midstate, sigma_a_prime, sigma_b_prime),
+                     self.value('sigma_c_prime'))
+    # finish_sigma_c() leaves the midstate for another sigma_b
+    self.assertEqual(finish_sigma_c(params, pre.midstate, sigma_a_prime, sigma_b_prime),
+                     self.value('sigma_c_prime'))
+
+  def test_precompute_batch(self):
+    params, q = self.params, self.params.q
+    bases = Bases(params, self.value('gamma'), self.value('sigma_z'))
+    for pre in precompute_batch(params, bases, bytes.fromhex(self.v['PI']), 3, self.rng):
+      self.assertEqual(pre.alpha * pre.alpha_inverse % q, 1)
+      self.assertEqual(pre.h, pow(self.value('gamma'), pre.alpha, params.p))
+
+if __name__ == '__main__':
+  unittest.main()
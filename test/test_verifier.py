@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+#
+# test_verifier.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+The verifier in tools/uprove.py against the token and presentation proof
+of test/testvectors.txt, and against malformed copies of them, and the
+presentation proofs of tokens issued by the host prover.
+
+  python3 test/test_verifier.py
+"""
+
+import os
+import sys
+import unittest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', 'tools'))
+
+from uprove import *
+
+class VerifierTest(unittest.TestCase):
+  @classmethod
+  def setUpClass(cls):
+    v = read_vectors(os.path.join(HERE, 'testvectors.txt'))
+    cls.params = params = IssuerParameters.from_vectors(v)
+    cls.verifier = Verifier(params, bytes.fromhex(v['TI']), bytes.fromhex(v['PI']))
+    cls.token = Token(*[int(v[k], 16) for k in ('h', 'sigma_z_prime', 'sigma_c_prime', 'sigma_r_prime')])
+    disclosed = [int(i) for i in v['D'].split(',')]
+    cls.m, cls.a = bytes.fromhex(v['m']), int(v['a'], 16)
+    cls.r = dict((i, int(v['r%d' % i], 16)) for i in [0] + [int(i) for i in v['U'].split(',')])
+    cls.attributes = dict((i, bytes.fromhex(v['A%d' % i])) for i in disclosed)
+    cls.values = [bytes.fromhex(v['A%d' % i]) for i in range(1, params.n + 1)]
+    cls.x = [int(v['x%d' % i], 16) for i in range(1, params.n + 1)]
+    cls.alpha_inverse, cls.y0 = int(v['alphaInverse'], 16), int(v['y0'], 16)
+    cls.w = dict((i, int(v['w%d' % i], 16)) for i in cls.r)
+
+  def proof(self, token=None, r=None, attributes=None):
+    return (token or self.token, self.m, self.a, self.r if r is None else r,
+            self.attributes if attributes is None else attributes)
+
+  def token_with(self, **values):
+    fields = dict(h=self.token.h, sigma_z=self.token.sigma_z, sigma_c=self.token.sigma_c,
+                  sigma_r=self.token.sigma_r)
+    fields.update(values)
+    return Token(fields['h'], fields['sigma_z'], fields['sigma_c'], fields['sigma_r'])
+
+  def test_vectors(self):
+    self.assertTrue(self.verifier.verify_token(self.token))
+    self.assertTrue(self.verifier.verify_proof(*self.proof()))
+
+  def test_token_out_of_range(self):
+    p, q = self.params.p, self.params.q
+    for values in (dict(sigma_c=(1 << 160) - 1), dict(sigma_c=q), dict(sigma_r=q), dict(sigma_r=-1),
+                   dict(h=1), dict(h=p), dict(sigma_z=0), dict(sigma_z=p)):
+      token = self.token_with(**values)
+      self.assertFalse(self.verifier.verify_token(token), values)
+      self.assertFalse(self.verifier.verify_proof(*self.proof(token=token)), values)
+
+  def test_response_out_of_range(self):
+    q = self.params.q
+    for i in self.r:
+      for value in (q, q + self.r[i], -1, (1 << 160) - 1):
+        r = dict(self.r)
+        r[i] = value
+        self.assertFalse(self.verifier.verify_proof(*self.proof(r=r)), (i, value))
+
+  def test_missing_response(self):
+    for i in self.r:
+      r = dict(self.r)
+      del r[i]
+      self.assertFalse(self.verifier.verify_proof(*self.proof(r=r)), i)
+
+  def test_disclosed_index_out_of_range(self):
+    for i in (0, self.params.n + 1):
+      attributes = dict(self.attributes)
+      attributes[i] = b'x'
+      self.assertFalse(self.verifier.verify_proof(*self.proof(attributes=attributes)), i)
+
+  def test_batch_keeps_going(self):
+    bad = self.proof(token=self.token_with(sigma_c=(1 << 160) - 1))
+    self.assertEqual(verify_batch(self.params, self.verifier.ti, self.verifier.pi,
+                                  [self.proof(), bad, self.proof()], 2), [True, False, True])
+
+  def test_prover_token_vectors(self):
+    token = ProverToken(self.token, self.alpha_inverse, self.x)
+    self.assertEqual(token.present(self.params, self.m, sorted(self.attributes), self.w), (self.a, self.r))
+
+  def test_batch_prover_presentation(self):
+    # tokens of the host prover, for the issuer of the vectors, presented
+    # with fresh randomness
+    issuer = Issuer(self.params, self.y0, self.verifier.ti, self.x)
+    with BatchProver(self.params, issuer.gamma, issuer.sigma_z, self.verifier.pi, self.x, 2, 2) as prover:
+      sigma_cs = prover.second_messages(issuer.first_messages(3))
+      tokens = prover.tokens(issuer.third_messages(sigma_cs))
+    self.assertEqual(len(tokens), 3)
+    for token in tokens:
+      self.assertTrue(self.verifier.verify_token(token.token))
+      for disclosed in ([], sorted(self.attributes), list(range(1, self.params.n + 1))):
+        a, r = token.present(self.params, self.m, disclosed)
+        attributes = dict((i, self.values[i - 1]) for i in disclosed)
+        self.assertTrue(self.verifier.verify_proof(token.token, self.m, a, r, attributes), disclosed)
+    # alpha^-1 of another token does not present
+    other = ProverToken(tokens[0].token, tokens[1].alpha_inverse, self.x)
+    a, r = other.present(self.params, self.m, sorted(self.attributes))
+    self.assertFalse(self.verifier.verify_proof(other.token, self.m, a, r, self.attributes))
+
+if __name__ == '__main__':
+  unittest.main()
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+#
+# apdutrace.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Record APDU sessions into a compact binary trace and replay them.
+
+A trace starts with the magic 'UPTR' and a version byte, followed by one
+record per command/response pair:
+
+  varint  gap      microseconds between the previous response and this command
+  varint  latency  microseconds until the response arrived
+  varint  length   of the command APDU, then the command APDU
+  varint  length   of the response data, then the response data
+  uint16  status word, big endian
+
+Set Card.recorder to a Recorder (throughput.py --record does this) to
+capture a session.  The applet's randomness (alpha, beta1, beta2 and w_i)
+comes from the card's RNG and never leaves it, so only sessions recorded
+in test mode (CMD_TEST P1=1, the fixed test values) replay byte for byte.
+With test mode off the responses to ISSUE_SIGMA_R depend on the card's
+own alpha and beta1 and only the other status words are compared.
+
+  tools/apdutrace.py dump session.uptr
+  tools/apdutrace.py replay session.uptr --command './simulator' --loop 100 --parallel 4
+"""
+
+import argparse
+import multiprocessing
+import sys
+import time
+
+from card import *
+from metrics import Metrics, instruction
+
+MAGIC = b'UPTR'
+VERSION = 1
+
+# Status words that depend on the card's RNG when test mode is off
+RANDOMISED = (CMD_ISSUE_SIGMA_R,)
+
+# First command of an issuance or a presentation, as sent by throughput.py
+SESSION_START = (CMD_ISSUE_PRECOMPUTE, CMD_PRESENT_SELECT_D)
+
+def put_varint(out, value):
+  while value >= 0x80:
+    out.append(0x80 | (value & 0x7F))
+    value >>= 7
+  out.append(value)
+
+def get_varint(data, offset):
+  value, shift = 0, 0
+  while True:
+    byte = data[offset]
+    offset += 1
+    value |= (byte & 0x7F) << shift
+    if byte < 0x80:
+      return value, offset
+    shift += 7
+
+class Record(object):
+  def __init__(self, gap, latency, apdu, response, sw):
+    self.gap, self.latency = gap, latency
+    self.apdu, self.response, self.sw = apdu, response, sw
+
+  def encode(self):
+    out = bytearray()
+    put_varint(out, self.gap)
+    put_varint(out, self.latency)
+    put_varint(out, len(self.apdu))
+    out += self.apdu
+    put_varint(out, len(self.response))
+    out += self.response
+    out += bytes([self.sw >> 8, self.sw & 0xFF])
+    return bytes(out)
+
+class Recorder(object):
+  def __init__(self, path):
+    self.out = open(path, 'wb')
+    self.out.write(MAGIC + bytes([VERSION]))
+    self.last = None
+
+  def write(self, apdu, response, sw, start, end):
+    """start and end are time.perf_counter() values."""
+    gap = 0 if self.last is None else max(0, round((start - self.last) * 1e6))
+    self.out.write(Record(gap, round((end - start) * 1e6), apdu, response, sw).encode())
+    self.last = end
+
+  def close(self):
+    self.out.close()
+
+def read(path):
+  with open(path, 'rb') as f:
+    data = f.read()
+  if data[:4] != MAGIC or data[4] != VERSION:
+    raise ValueError('%s is not a version %d APDU trace' % (path, VERSION))
+  records, offset = [], 5
+  while offset < len(data):
+    gap, offset = get_varint(data, offset)
+    latency, offset = get_varint(data, offset)
+    length, offset = get_varint(data, offset)
+    apdu, offset = data[offset:offset + length], offset + length
+    length, offset = get_varint(data, offset)
+    response, offset = data[offset:offset + length], offset + length
+    records.append(Record(gap, latency, apdu, response, (data[offset] << 8) | data[offset + 1]))
+    offset += 2
+  return records
+
+def replay(card, records, paced=False):
+  """Send every command again; returns the number of mismatching responses.
+
+  A session runs from one SESSION_START command to the next (or to the
+  end of the trace) and is counted in card.metrics while it is replayed.
+  """
+  mismatches = 0
+  test_mode = True  # the applet's default
+  in_session = False
+  for record in records:
+    if paced and record.gap:
+      time.sleep(record.gap / 1e6)
+    if record.apdu[1] in SESSION_START:
+      if in_session:
+        card.metrics.finish_session()
+      card.metrics.start_session()
+      in_session = True
+    response, sw = card.exchange(record.apdu)
+    # CMD_TEST P1 = 0/1 sets the mode, P1 = 2 wipes the card and keeps it
+    if record.apdu[1] == CMD_TEST and record.sw == ERR_OK and record.apdu[2] != 2:
+      test_mode = record.apdu[2] != 0
+    if test_mode:
+      same = (response, sw) == (record.response, record.sw)
+    else:
+      same = sw == record.sw or record.apdu[1] in RANDOMISED
+    mismatches += not same
+  if in_session:
+    card.metrics.finish_session()
+  return mismatches
+
+def _replay_worker(job):
+  (worker, path, args) = job
+  card = CommandCard(args.command) if args.command else PCSCCard(args.reader + worker)
+  records = read(path)
+  mismatches = 0
+  for _ in range(args.loop):
+    mismatches += replay(card, records, args.paced)
+  return card.metrics, mismatches
+
+def main():
+  parser = argparse.ArgumentParser(description='Dump or replay recorded APDU sessions.')
+  parser.add_argument('action', choices=('dump', 'replay'))
+  parser.add_argument('trace')
+  parser.add_argument('--reader', type=int, default=0, help='first PC/SC reader, worker i uses reader + i')
+  parser.add_argument('--command', help='simulator command instead of a reader, one per worker')
+  parser.add_argument('--loop', type=int, default=1, help='replay the trace this many times')
+  parser.add_argument('--parallel', type=int, default=1, help='cards replaying the trace at the same time')
+  parser.add_argument('--paced', action='store_true', help='keep the recorded gaps between commands')
+  parser.add_argument('--metrics', help='write the merged Prometheus metrics here')
+  args = parser.parse_args()
+
+  records = read(args.trace)
+  if args.action == 'dump':
+    for record in records:
+      print('%8d %8d  %-24s %s -> %s %04X' % (record.gap, record.latency, instruction(record.apdu[1]),
+                                               record.apdu.hex(), record.response.hex(), record.sw))
+    return 0
+
+  start = time.perf_counter()
+  jobs = [(i, args.trace, args) for i in range(args.parallel)]
+  if args.parallel == 1:
+    results = [_replay_worker(jobs[0])]
+  else:
+    with multiprocessing.Pool(args.parallel) as pool:
+      results = pool.map(_replay_worker, jobs)
+  elapsed = time.perf_counter() - start
+
+  metrics, mismatches = Metrics(), 0
+  for (m, n) in results:
+    metrics.merge(m)
+    mismatches += n
+  total = len(records) * args.loop * args.parallel
+  print('%d APDUs in %.3f s, %.1f APDU/s, %d mismatching responses' %
+        (total, elapsed, total / elapsed if elapsed else 0.0, mismatches))
+  metrics.summary(sys.stdout)
+  if args.metrics:
+    metrics.export(args.metrics)
+  return 1 if mismatches else 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# benchmark.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Per-function benchmarks of the protocol building blocks.
+
+The SIMULATOR build brackets computeXt(), calcGamma(), calcSigmaZ(),
+doPrecomputations(), sigmaBCommittment(), sigmaRCommittment(0/1),
+challengeM(), generateChallengeC() and putNumberIntoArray() with [FUN]
+trace lines.  The script (test/testscript.txt by default, i.e. the test
+vector inputs on a MAX_ATTR=5 build) is run once, every call is charged
+against the cost model and the mean cost per call is compared with the
+baseline in test/benchmark.txt.  The exit status is 1 when a function got
+slower than the threshold allows or disappeared.
+
+The numbers are modelled, not measured: they only change when the
+primitives a function calls (or their operand sizes) change, so running
+the same script again gives the same result.  Timings on a card still
+have to be taken with the card's own tools.
+
+  tools/benchmark.py --simulator 'hsim -script {script} bin/5/uprove.simulator-ML3.hzx'
+  tools/benchmark.py --update simulator.log
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+import costmodel
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+def per_call(commands, table):
+  """Mean cost per call of every traced function."""
+  totals, counts = {}, {}
+  for cmd in commands:
+    for call in cmd.calls:
+      totals[call.name] = totals.get(call.name, 0.0) + call.cost(table)
+      counts[call.name] = counts.get(call.name, 0) + 1
+  return dict((name, totals[name] / counts[name]) for name in totals)
+
+def collect(commands):
+  """{function: {platform: modelled ms per call}}"""
+  results = {}
+  for platform in sorted(costmodel.PLATFORMS):
+    for (name, ms) in per_call(commands, costmodel.PLATFORMS[platform]).items():
+      results.setdefault(name, {})[platform] = ms
+  return results
+
+def read_baseline(path):
+  baseline = {}
+  platforms = sorted(costmodel.PLATFORMS)
+  with open(path) as f:
+    for line in f:
+      if line.startswith('#'):
+        if line[1:].split()[:1] == ['function']:
+          platforms = line[1:].split()[1:]
+        continue
+      fields = line.split()
+      if fields:
+        baseline[fields[0]] = dict(zip(platforms, [float(x) for x in fields[1:]]))
+  return baseline
+
+def write_baseline(path, results):
+  platforms = sorted(costmodel.PLATFORMS)
+  with open(path, 'w') as f:
+    f.write('# cost model output (tools/costmodel.py), ms per call, not measured on a card\n')
+    f.write('# %-28s' % 'function' + ''.join('%12s' % p for p in platforms) + '\n')
+    for name in sorted(results):
+      f.write('  %-28s' % name + ''.join('%12.3f' % results[name][p] for p in platforms) + '\n')
+
+def main():
+  parser = argparse.ArgumentParser(description='Benchmark the protocol building blocks against a baseline.')
+  parser.add_argument('trace', nargs='*', help='simulator traces to use instead of running --simulator')
+  parser.add_argument('--simulator', help='command printing the SIMULATOR trace for {script}')
+  parser.add_argument('--script', default=os.path.join(ROOT, 'test', 'testscript.txt'))
+  parser.add_argument('--baseline', default=os.path.join(ROOT, 'test', 'benchmark.txt'))
+  parser.add_argument('--threshold', type=float, default=0.05, help='allowed slowdown, 0.05 is 5%%')
+  parser.add_argument('--update', action='store_true', help='store the results as the new baseline')
+  args = parser.parse_args()
+
+  commands = []
+  for path in args.trace:
+    with open(path) as f:
+      commands.extend(costmodel.parse(f))
+  if args.simulator:
+    trace = subprocess.check_output(args.simulator.format(script=args.script), shell=True, cwd=ROOT,
+                                    universal_newlines=True)
+    commands.extend(costmodel.parse(trace.splitlines()))
+  if not commands:
+    parser.error('give traces or --simulator')
+  results = collect(commands)
+
+  if args.update:
+    write_baseline(args.baseline, results)
+    return 0
+
+  baseline = read_baseline(args.baseline)
+  failures = 0
+  out = sys.stdout
+  out.write('%-30s%-6s%12s%12s%9s\n' % ('function', '', 'baseline', 'model', 'change'))
+  for name in sorted(set(baseline) | set(results)):
+    for platform in sorted(costmodel.PLATFORMS):
+      before = baseline.get(name, {}).get(platform)
+      now = results.get(name, {}).get(platform)
+      if now is None:
+        out.write('%-30s%-6s%12.3f%12s%9s  MISSING\n' % (name, platform, before, '-', '-'))
+        failures += 1
+        continue
+      if before is None:
+        out.write('%-30s%-6s%12s%12.3f%9s  NEW\n' % (name, platform, '-', now, '-'))
+        continue
+      change = (now - before) / before if before else 0.0
+      slower = now > before * (1.0 + args.threshold)
+      failures += slower
+      out.write('%-30s%-6s%12.3f%12.3f%+8.1f%%%s\n' %
+                (name, platform, before, now, 100.0 * change, '  SLOWER' if slower else ''))
+  return 1 if failures else 0
+
+if __name__ == '__main__':
+  sys.exit(main())
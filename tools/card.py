@@ -0,0 +1,144 @@
+#
+# card.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Transports to the uprove applet.
+
+PCSCCard talks to a reader through pyscard.  CommandCard drives any
+program that reads one hex encoded command APDU per line on stdin and
+answers with one line holding the hex encoded response data followed by
+the status word, which is how simulators are hooked up.
+"""
+
+import subprocess
+import time
+
+from metrics import Metrics
+
+UPROVE_AID = bytes.fromhex('7570726F7665')
+UPROVE_CLA = 0x00
+
+# Instructions, mirroring include/defs_apdu.h
+CMD_INIT_PRECOMPUTE_INPUTS = 0x0D
+CMD_INIT_STREAM_ATTRVAL = 0x0E
+CMD_ISSUE_PRECOMPUTE = 0x11
+CMD_ISSUE_SIGMA_A = 0x12
+CMD_ISSUE_SIGMA_B = 0x13
+CMD_ISSUE_SIGMA_R = 0x14
+CMD_PRESENT_SELECT_D = 0x20
+CMD_PRESENT_CHALLENGE_M = 0x21
+CMD_PRESENT_DISCLOSE_AI = 0x22
+CMD_PRESENT_RETURN_RI = 0x23
+CMD_PRESENT_RETURN_SIGMAS = 0x24
+CMD_TEST = 0xFF
+
+RETURN_RI_ALL = 0xFF
+
+# Number sizes from include/defs_sizes.h
+PSIZE_BYTES = 128
+QSIZE_BYTES = 20
+
+# CMD_INIT_STREAM_ATTRVAL chunk size, all but the last chunk are whole SHA-1 blocks
+STREAM_CHUNK = 3 * 64
+
+ERR_OK = 0x9000
+
+class CardError(Exception):
+  def __init__(self, command, sw):
+    Exception.__init__(self, 'INS %02X returned %04X' % (command[1], sw))
+    self.sw = sw
+
+def command(ins, p1=0, p2=0, data=b''):
+  """Build a case 1 (no data) or case 3 (data) command APDU."""
+  apdu = bytes([UPROVE_CLA, ins, p1, p2])
+  if data:
+    apdu += bytes([len(data)]) + bytes(data)
+  return apdu
+
+class Card(object):
+  def __init__(self):
+    self.metrics = Metrics()
+    self.recorder = None  # an apdutrace.Recorder
+
+  def transmit(self, apdu):
+    raise NotImplementedError
+
+  def exchange(self, apdu):
+    """transmit() with the round trip recorded in self.metrics."""
+    start = time.perf_counter()
+    response, sw = self.transmit(apdu)
+    end = time.perf_counter()
+    self.metrics.record(apdu, response, sw, (end - start) * 1000.0)
+    if self.recorder:
+      self.recorder.write(apdu, response, sw, start, end)
+    return response, sw
+
+  def send(self, ins, p1=0, p2=0, data=b''):
+    """Send a command and return its response data, raising on errors."""
+    apdu = command(ins, p1, p2, data)
+    response, sw = self.exchange(apdu)
+    if sw != ERR_OK:
+      raise CardError(apdu, sw)
+    return response
+
+  def stream_attribute(self, i, n, value, chunk=STREAM_CHUNK):
+    """
+    Upload hashed attribute i (of n), e.g. one longer than 255 bytes; the card keeps only x_i.
+    Values of 20 or 128 bytes are refused, as the card would hash them without their
+    leading zeros; CMD_INIT_SET_RAWATTRVAL takes those.
+    """
+    if len(value) in (QSIZE_BYTES, PSIZE_BYTES):
+      raise ValueError('a %d byte value cannot be streamed' % len(value))
+    data = len(value).to_bytes(4, 'big') + bytes(value)
+    for offset in range(0, len(data), chunk):
+      self.send(CMD_INIT_STREAM_ATTRVAL, i if offset == 0 else 0, n, data[offset:offset + chunk])
+
+  def select(self):
+    apdu = bytes([0x00, 0xA4, 0x04, 0x00, len(UPROVE_AID)]) + UPROVE_AID
+    response, sw = self.exchange(apdu)
+    if sw != ERR_OK:
+      raise CardError(apdu, sw)
+
+class PCSCCard(Card):
+  def __init__(self, reader=0):
+    Card.__init__(self)
+    from smartcard.System import readers
+    self.connection = readers()[reader].createConnection()
+    self.connection.connect()
+
+  def transmit(self, apdu):
+    response, sw1, sw2 = self.connection.transmit(list(apdu))
+    return bytes(response), (sw1 << 8) | sw2
+
+class CommandCard(Card):
+  def __init__(self, argv):
+    Card.__init__(self)
+    self.process = subprocess.Popen(argv, shell=isinstance(argv, str), universal_newlines=True,
+                                    stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+  def transmit(self, apdu):
+    self.process.stdin.write(apdu.hex() + '\n')
+    self.process.stdin.flush()
+    response = bytes.fromhex(self.process.stdout.readline().strip())
+    if len(response) < 2:
+      raise IOError('no response to %s' % apdu.hex())
+    return response[:-2], (response[-2] << 8) | response[-1]
+
+def connect(reader=None, argv=None, recorder=None):
+  card = CommandCard(argv) if argv else PCSCCard(reader or 0)
+  card.recorder = recorder
+  card.select()
+  return card
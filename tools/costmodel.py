@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+#
+# costmodel.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Estimate on-card latency from a simulator trace.
+
+The SIMULATOR build prints a "[CMD] INS P1 P2 Lc" line when an APDU enters
+main() and a "[PRM] name length1 length2" line for every ModExp,
+ModExpSecure, ModMul, SHA1, Random and Copy primitive call (see
+funcs_debug.c).  This script charges those events against a per-platform
+calibration table and reports the estimated latency per APDU and per
+protocol phase.  "[FUN] > name" and "[FUN] < name" lines bracket the
+protocol building blocks; the primitives in between are collected per
+call for benchmark.py.
+
+  hsim ... | tools/costmodel.py --platform ML2
+  tools/costmodel.py --platform all simulator.log
+"""
+
+import argparse
+import sys
+
+# Calibration tables, in milliseconds.  ModExp figures are for a 160-bit
+# exponent and a 1024-bit modulus and are scaled linearly in the exponent
+# length and quadratically in the modulus length; ModMul is scaled
+# quadratically in the modulus length.  These are nominal figures: replace
+# them with card-lab measurements for the silicon at hand.
+PLATFORMS = {
+  'ML2': {
+    'ModExp': 180.0,
+    'ModExpSecure': 260.0,
+    'ModMul': 4.0,
+    'SHA1': 0.9,          # per call
+    'SHA1_block': 0.35,   # per 64-byte block
+    'Random': 1.5,
+    'Copy_byte': 0.004,
+    'EEPROM_byte': 0.06,
+    'APDU': 8.0,          # per command/response pair
+    'IO_byte': 0.09,
+  },
+  'ML3': {
+    'ModExp': 75.0,
+    'ModExpSecure': 110.0,
+    'ModMul': 1.6,
+    'SHA1': 0.4,
+    'SHA1_block': 0.12,
+    'Random': 0.8,
+    'Copy_byte': 0.002,
+    'EEPROM_byte': 0.03,
+    'APDU': 5.0,
+    'IO_byte': 0.09,
+  },
+}
+
+REF_EXPONENT = 20
+REF_MODULUS = 128
+
+PSIZE_BYTES = 128
+QSIZE_BYTES = 20
+TI_LENGTH = 29
+PI_LENGTH = 30
+S_LENGTH = 31
+
+# h, PI and sigma_z' as doPrecomputations() encodes them in tempArray
+SIGMA_C_PREFIX = 2 * (4 + PSIZE_BYTES) + 4 + PI_LENGTH
+
+# Instruction names and protocol phases, mirroring include/defs_apdu.h.
+INSTRUCTIONS = {
+  0x00: 'INIT_SET_NOT', 0x30: 'INIT_GET_NOT',
+  0x01: 'INIT_SET_UIDP', 0x31: 'INIT_GET_UIDP',
+  0x02: 'INIT_SET_PQG', 0x32: 'INIT_GET_PQG',
+  0x03: 'INIT_SET_UIDH', 0x33: 'INIT_GET_UIDH',
+  0x04: 'INIT_SET_PUBKEY', 0x34: 'INIT_GET_PUBKEY',
+  0x05: 'INIT_SET_EI', 0x35: 'INIT_GET_EI',
+  0x06: 'INIT_SET_ISSUEVAL', 0x36: 'INIT_GET_ISSUEVAL',
+  0x07: 'INIT_SET_SPEC', 0x37: 'INIT_GET_SPEC',
+  0x08: 'INIT_SET_RAWATTRVAL', 0x38: 'INIT_GET_RAWATTRVAL',
+  0x09: 'INIT_SET_TI', 0x39: 'INIT_GET_TI',
+  0x0A: 'INIT_SET_PI', 0x3A: 'INIT_GET_PI',
+  0x0B: 'INIT_SET_ATTRVAL', 0x3B: 'INIT_GET_ATTRVAL',
+  0x0C: 'INIT_SET_ATTRCOUNT', 0x3C: 'INIT_GET_ATTRCOUNT',
+  0x0D: 'INIT_PRECOMPUTE_INPUTS', 0x0E: 'INIT_STREAM_ATTRVAL',
+  0x11: 'ISSUE_PRECOMPUTE', 0x12: 'ISSUE_SIGMA_A',
+  0x13: 'ISSUE_SIGMA_B', 0x14: 'ISSUE_SIGMA_R',
+  0x20: 'PRESENT_SELECT_D', 0x21: 'PRESENT_CHALLENGE_M',
+  0x22: 'PRESENT_DISCLOSE_AI', 0x23: 'PRESENT_RETURN_RI',
+  0x24: 'PRESENT_RETURN_SIGMAS',
+  0xFF: 'TEST',
+}
+
+def phase(ins):
+  if 0x11 <= ins <= 0x1F:
+    return 'issuance'
+  if 0x20 <= ins <= 0x2F:
+    return 'presentation'
+  return 'personalisation'
+
+def response_length(cmd):
+  """Response data length; ExitLa() is not traced so this follows uprove.c."""
+  ins, p1 = cmd.ins, cmd.p1
+  if ins in (0x22, 0x31, 0x35, 0x38):
+    # UID_p, e_i and the attribute values depend on the card state, the copy
+    # into the response is traced
+    return sum(l for (n, l, _) in cmd.primitives if n == 'Copy')
+  if ins == 0x23 and p1 == 0xFF:
+    # r_0 and the undisclosed r_i, P2 is n + 1
+    return QSIZE_BYTES * (cmd.p2 - cmd.disclosed)
+  if ins in (0x13, 0x21, 0x23, 0x3B):
+    return QSIZE_BYTES
+  if ins in (0x34, 0x36):
+    return PSIZE_BYTES
+  if ins == 0x32:
+    return {1: QSIZE_BYTES, 3: 1}.get(p1, PSIZE_BYTES)
+  if ins == 0x24:
+    return PSIZE_BYTES if p1 < 2 else QSIZE_BYTES
+  if ins in (0x30, 0x3C):
+    return 1
+  return {0x37: S_LENGTH, 0x39: TI_LENGTH, 0x3A: PI_LENGTH}.get(ins, 0)
+
+def eeprom_writes(cmd):
+  """Bytes written to static memory, estimated from the code in uprove.c."""
+  ins = cmd.ins
+  hashed = [l for (n, l, _) in cmd.primitives if n == 'SHA1']
+  mults = len([n for (n, _, _) in cmd.primitives if n == 'ModMul'])
+  moved = sum(l for (n, l, _) in cmd.primitives if n == 'Move')
+  if ins in (0x01, 0x02, 0x04, 0x05, 0x06, 0x0B):
+    return cmd.lc
+  if ins == 0x0C:
+    # attrCount and, when it changes, g_t, z_t and x_t moved next to attribute n
+    return cmd.lc + moved
+  if ins == 0x08:
+    # the value appended to attrHeap, its offset, size and attrHeapUsed, x_i,
+    # and the values compactAttributes() moved down with their offsets
+    return cmd.lc + 5 + QSIZE_BYTES + sum(hashed) + moved + \
+      2 * len([n for (n, _, _) in cmd.primitives if n == 'Move'])
+  if ins == 0x0E:
+    # x_i and attrSize, written by the last chunk only (the hash state is in
+    # RAM), charged to every continuation chunk as the trace cannot tell
+    return QSIZE_BYTES + 1 if cmd.p1 == 0 else 0
+  if ins == 0x0D:
+    # P encoding in tempArray, x_t, gamma and sigma_z updates
+    return (hashed[0] if hashed else 0) + QSIZE_BYTES + PSIZE_BYTES * (mults + 2)
+  if ins == 0x11:
+    # h, sigma_z', alphaInverse and the sigma_c' prefix in tempArray
+    return 2 * PSIZE_BYTES + QSIZE_BYTES + sum(hashed)
+  if ins == 0x12:
+    return 2 * PSIZE_BYTES
+  if ins == 0x13:
+    # sigma_b' and sigma_c', sigma_a' and sigma_b' appended to the prefix in
+    # tempArray, whose tail the hash goes over again
+    return 2 * PSIZE_BYTES + sum(hashed) - SIGMA_C_PREFIX % 64 + QSIZE_BYTES
+  if ins == 0x14:
+    return QSIZE_BYTES * 2 + (4 * PSIZE_BYTES if mults else 0)
+  return 0
+
+def primitive_cost(table, name, length1, length2):
+  if name in ('ModExp', 'ModExpSecure'):
+    return table[name] * (float(length1) / REF_EXPONENT) * (float(length2) / REF_MODULUS) ** 2
+  if name == 'ModMul':
+    return table[name] * (float(length1) / REF_MODULUS) ** 2
+  if name == 'SHA1':
+    return table[name] + table['SHA1_block'] * ((length1 + 8) // 64 + 1)
+  if name in ('Copy', 'Move'):
+    return table['Copy_byte'] * length1
+  return table.get(name, 0.0)
+
+class Call(object):
+  """One run of a function bracketed by [FUN] lines."""
+
+  def __init__(self, name):
+    self.name = name
+    self.primitives = []
+
+  def cost(self, table):
+    return sum(primitive_cost(table, *primitive) for primitive in self.primitives)
+
+class Command(object):
+  def __init__(self, ins, p1, p2, lc):
+    self.ins, self.p1, self.p2, self.lc = ins, p1, p2, lc
+    self.disclosed = 0  # Lc of the last PRESENT_SELECT_D
+    self.primitives = []
+    self.calls = []
+    self.open = []
+
+  def name(self):
+    return INSTRUCTIONS.get(self.ins, '%02X' % self.ins)
+
+  def cost(self, table):
+    total = table['APDU'] + table['IO_byte'] * (5 + self.lc + response_length(self) + 2)
+    for primitive in self.primitives:
+      total += primitive_cost(table, *primitive)
+    return total + table['EEPROM_byte'] * eeprom_writes(self)
+
+def command(fields, previous=None):
+  """The Command of a [CMD] line, following the previous one in the trace."""
+  cmd = Command(int(fields[1], 16), int(fields[2], 16), int(fields[3], 16), int(fields[4]))
+  if cmd.ins == 0x20:
+    cmd.disclosed = cmd.lc
+  elif previous is not None:
+    cmd.disclosed = previous.disclosed
+  return cmd
+
+def parse(stream):
+  commands = []
+  for line in stream:
+    fields = line.split()
+    if len(fields) == 5 and fields[0] == '[CMD]':
+      commands.append(command(fields, commands[-1] if commands else None))
+    elif len(fields) == 4 and fields[0] == '[PRM]' and commands:
+      primitive = (fields[1], int(fields[2]), int(fields[3]))
+      commands[-1].primitives.append(primitive)
+      for call in commands[-1].open:
+        call.primitives.append(primitive)
+    elif len(fields) == 3 and fields[0] == '[FUN]' and commands:
+      cmd = commands[-1]
+      if fields[1] == '>':
+        cmd.open.append(Call(fields[2]))
+      elif cmd.open and cmd.open[-1].name == fields[2]:
+        cmd.calls.append(cmd.open.pop())
+  return commands
+
+def report(commands, platform, out):
+  table = PLATFORMS[platform]
+  totals = {}
+  out.write('# Platform %s\n' % platform)
+  for cmd in commands:
+    cost = cmd.cost(table)
+    totals[phase(cmd.ins)] = totals.get(phase(cmd.ins), 0.0) + cost
+    out.write('%-24s P1=%02X P2=%02X Lc=%-3d %10.1f ms\n' % (cmd.name(), cmd.p1, cmd.p2, cmd.lc, cost))
+  for name in ('personalisation', 'issuance', 'presentation'):
+    if name in totals:
+      out.write('%-24s %31.1f ms\n' % ('total ' + name, totals[name]))
+
+def main():
+  parser = argparse.ArgumentParser(description='Estimate on-card latency from a simulator trace.')
+  parser.add_argument('trace', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+  parser.add_argument('--platform', default='ML3', choices=sorted(PLATFORMS) + ['all'])
+  args = parser.parse_args()
+
+  commands = parse(args.trace)
+  for platform in (sorted(PLATFORMS) if args.platform == 'all' else [args.platform]):
+    report(commands, platform, sys.stdout)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+#
+# genparams.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Generate issuer parameters, test vectors and an APDU script for n attributes.
+
+The group, y0, TI, PI, S and the test-mode randomness (alpha, beta1, beta2,
+w_0..w_5) are taken from test/testvectors.txt, as are g_1..g_5 and the
+attributes A_1..A_5.  Generators and attributes beyond the fifth are
+derived deterministically, and the w_i test values beyond the fifth are
+zero, just like the w_iTest defaults of a card built with a larger
+MAX_ATTR.  For n = 5 the output reproduces test/testvectors.txt.
+
+The script personalises a card built with MAX_ATTR = n and runs one
+issuance and one presentation in test mode, in the test/testscript.txt
+layout; the vectors hold every intermediate value the card should produce.
+
+  tools/genparams.py 8 --vectors vectors8.txt --script script8.txt
+"""
+
+import argparse
+import os
+import sys
+
+from uprove import *
+
+BASE_ATTRIBUTES = 5
+
+def derive(label, i, q):
+  """Deterministic exponent for the generators beyond the test vectors."""
+  return to_int(sha1(b'uprove genparams ' + label + b' %d' % i)) % q
+
+def generate(base, n, disclosed):
+  v = {}
+  for name in ('UIDp', 'p', 'q', 'g', 'y0', 'TI', 'PI', 'S', 'UIDh', 'alpha', 'beta1', 'beta2', 'w', 'm'):
+    v[name] = base[name]
+  p, q, g = int(base['p'], 16), int(base['q'], 16), int(base['g'], 16)
+  y0 = int(base['y0'], 16)
+
+  g_i = [int(base['g0'], 16)]
+  attributes, e_i = [], []
+  for i in range(1, n + 1):
+    if i <= BASE_ATTRIBUTES:
+      g_i.append(int(base['g%d' % i], 16))
+      attributes.append(bytes.fromhex(base['A%d' % i]))
+      e_i.append(int(base['e%d' % i]))
+    else:
+      v['y%d' % i] = '%x' % derive(b'y', i, q)
+      g_i.append(pow(g, derive(b'y', i, q), p))
+      attributes.append(b'Attribute %d' % i)
+      e_i.append(1)
+  g_i.append(int(base['gt'], 16))
+  params = IssuerParameters(bytes.fromhex(base['UIDp']), p, q, g, g_i, e_i, bytes.fromhex(base['S']))
+
+  for (i, (gen, z)) in enumerate(zip(g_i, params.z_i(y0))):
+    name = 't' if i == n + 1 else str(i)
+    v['g' + name] = '%x' % gen
+    v['z' + name] = '%x' % z
+  x = []
+  for i in range(1, n + 1):
+    v['A%d' % i] = attributes[i - 1].hex()
+    v['e%d' % i] = str(e_i[i - 1])
+    x.append(params.x_i(attributes[i - 1], i))
+    v['x%d' % i] = '%x' % x[-1]
+
+  # Precomputation: P, x_t, gamma and sigma_z
+  ti, pi = bytes.fromhex(base['TI']), bytes.fromhex(base['PI'])
+  x_t = params.x_t(ti)
+  gamma = params.gamma(x, x_t)
+  sigma_z = pow(gamma, y0, p)
+  v['P'] = params.digest().hex()
+  v['xt'] = '%x' % x_t
+  v['gamma'] = '%x' % gamma
+  v['sigma_z'] = '%x' % sigma_z
+
+  # Issuance with the test-mode alpha, beta1, beta2 and the issuer's w
+  alpha, beta1, beta2 = [int(base[k], 16) for k in ('alpha', 'beta1', 'beta2')]
+  w = int(base['w'], 16)
+  h = pow(gamma, alpha, p)
+  sigma_z_prime = pow(sigma_z, alpha, p)
+  alpha_inverse = pow(alpha, q - 2, q)
+  sigma_a, sigma_b = pow(g, w, p), pow(gamma, w, p)
+  sigma_a_prime = multi_exp([(g_i[0], beta1), (g, beta2)], p) * sigma_a % p
+  sigma_b_prime = multi_exp([(sigma_z_prime, beta1), (h, beta2), (sigma_b, alpha)], p)
+  midstate = sigma_c_midstate(params, h, pi, sigma_z_prime)
+  sigma_c_prime = finish_sigma_c(params, midstate, sigma_a_prime, sigma_b_prime)
+  sigma_c = (sigma_c_prime + beta1) % q
+  sigma_r = (sigma_c * y0 + w) % q
+  sigma_r_prime = (sigma_r + beta2) % q
+  for (name, value) in (('h', h), ('sigma_z_prime', sigma_z_prime), ('alphaInverse', alpha_inverse),
+                        ('sigma_a', sigma_a), ('sigma_b', sigma_b),
+                        ('sigma_a_prime', sigma_a_prime), ('sigma_b_prime', sigma_b_prime),
+                        ('sigma_c_prime', sigma_c_prime), ('sigma_c', sigma_c),
+                        ('sigma_r', sigma_r), ('sigma_r_prime', sigma_r_prime)):
+    v[name] = '%x' % value
+  token = Token(h, sigma_z_prime, sigma_c_prime, sigma_r_prime)
+
+  # Presentation with the w_iTest values
+  undisclosed = [i for i in range(1, n + 1) if i not in disclosed]
+  w_i = [int(base.get('w%d' % i, '0'), 16) if i <= BASE_ATTRIBUTES else 0 for i in range(n + 1)]
+  t = pow(h, w_i[0], p)
+  for i in undisclosed:
+    t = t * pow(g_i[i], w_i[i], p) % p
+  a = to_int(sha1(put_number(params.p_bytes(t)))) % q
+  uid_t = token.uid(params)
+  m = bytes.fromhex(base['m'])
+  c = challenge_c(params, uid_t, a, m, disclosed, x)
+  v['D'] = ','.join(str(i) for i in disclosed)
+  v['U'] = ','.join(str(i) for i in undisclosed)
+  for i in [0] + undisclosed:
+    v['w%d' % i] = '%x' % w_i[i]
+  v['a'] = '%x' % a
+  v['UIDt'] = '%x' % uid_t
+  v['c'] = '%x' % c
+  r = {0: (c * alpha_inverse + w_i[0]) % q}
+  for i in undisclosed:
+    r[i] = (w_i[i] - c * x[i - 1]) % q
+  for i in sorted(r):
+    v['r%d' % i] = '%x' % r[i]
+
+  verifier = Verifier(params, ti, pi)
+  assert verifier.verify_proof(token, m, a, r, dict((i, attributes[i - 1]) for i in disclosed))
+  return v
+
+def apdu(ins, p1=0, p2=0, data=None):
+  header = '00%02X%02X%02X' % (ins, p1, p2)
+  if data is None:
+    return header
+  return header + '%02X' % len(data) + data.hex()
+
+def script(v, n, builtin_group=False):
+  """
+  APDUs in the test/testscript.txt layout; with builtin_group p, q and g
+  are not uploaded but the card is asked which group it holds.
+  """
+  p_bytes = lambda name: to_bytes(int(v[name], 16), PSIZE_BYTES)
+  q_bytes = lambda name: to_bytes(int(v[name], 16), QSIZE_BYTES)
+  disclosed = [int(i) for i in v['D'].split(',') if i]
+  names = [str(i) for i in range(n + 1)] + ['t']
+  lines = ['Selection:', '00A40400067570726F7665', '',
+           'Set n:', '', apdu(0x0C, data=bytes([n])), '',
+           'Set UID_p:', '', apdu(0x01, data=bytes.fromhex(v['UIDp'])), '']
+  if builtin_group:
+    group = group_of(int(v['p'], 16), int(v['q'], 16), int(v['g'], 16))
+    lines += ['Get group (expect %02X):' % group, apdu(0x32, 3), '']
+  else:
+    lines += ['Set p:', apdu(0x02, 0, data=p_bytes('p')), '',
+              'Set q:', apdu(0x02, 1, data=q_bytes('q')), '',
+              'Set g:', apdu(0x02, 2, data=p_bytes('g')), '']
+  lines += ['Set e_i:', '', apdu(0x05, data=bytes(int(v['e%d' % i]) for i in range(1, n + 1))), '',
+            'Set g_i:', '']
+  for (i, name) in enumerate(names):
+    lines += ['g%s:' % name, apdu(0x04, i, n + 2, p_bytes('g' + name))]
+  lines += ['', 'Set z_i:', '']
+  for (i, name) in enumerate(names):
+    lines += ['z%s:' % name, apdu(0x06, i, n + 2, p_bytes('z' + name))]
+  lines += ['', 'Set A_i:', '']
+  for i in range(1, n + 1):
+    lines += ['A_%d:' % i, '', apdu(0x08, i, n, bytes.fromhex(v['A%d' % i])), '']
+  lines += ['Precompute inputs:', '', apdu(0x0D), '',
+            'do precomputations:', '', apdu(0x11), '',
+            'sigma_a:', '', apdu(0x12, data=p_bytes('sigma_a')), '',
+            'sigma_b:', '', apdu(0x13, data=p_bytes('sigma_b')), '',
+            'sigma_r (verify signature):', apdu(0x14, 1, data=q_bytes('sigma_r')), '',
+            'D:', '', apdu(0x20, data=bytes(disclosed) or None), '',
+            'm:', '', apdu(0x21, data=bytes.fromhex(v['m'])), '',
+            'get A_i:', '']
+  for i in disclosed:
+    lines += [apdu(0x22, i, n), '']
+  lines += ['get r_i:', '']
+  for i in [0] + [i for i in range(1, n + 1) if i not in disclosed]:
+    lines += [apdu(0x23, i, n + 1), '']
+  lines += ['get h, sigma_z_prime, sigma_c_prime, sigma_r_prime', '']
+  for i in range(4):
+    lines += [apdu(0x24, i, 4), '']
+  return '\n'.join(lines)
+
+def main():
+  parser = argparse.ArgumentParser(description='Generate issuer parameters and test vectors for n attributes.')
+  parser.add_argument('n', type=int, help='number of attributes (MAX_ATTR of the card build)')
+  parser.add_argument('--base', default=os.path.join(os.path.dirname(__file__), '..', 'test', 'testvectors.txt'))
+  parser.add_argument('--disclose', help='comma separated indices of disclosed attributes (default 2,5 where present)')
+  parser.add_argument('--vectors', type=argparse.FileType('w'), help='write the test vectors here')
+  parser.add_argument('--script', type=argparse.FileType('w'), help='write the APDU script here')
+  parser.add_argument('--builtin-group', action='store_true',
+                      help='leave p, q and g to the group the card is built with')
+  args = parser.parse_args()
+
+  if args.disclose is None:
+    disclosed = [i for i in (2, 5) if i <= args.n]
+  else:
+    disclosed = [int(i) for i in args.disclose.split(',') if i]
+  if not 1 <= args.n <= 255 or [i for i in disclosed if not 1 <= i <= args.n]:
+    parser.error('attribute index out of range')
+
+  v = generate(read_vectors(args.base), args.n, sorted(disclosed))
+  if args.builtin_group and group_of(int(v['p'], 16), int(v['q'], 16), int(v['g'], 16)) == GROUP_CUSTOM:
+    parser.error('p, q and g are not a built-in group')
+  if args.vectors:
+    args.vectors.write(''.join('%s: %s\n' % item for item in v.items()))
+  if args.script:
+    args.script.write(script(v, args.n, args.builtin_group) + '\n')
+  if not args.vectors and not args.script:
+    sys.stdout.write(''.join('%s: %s\n' % item for item in v.items()))
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,162 @@
+#
+# metrics.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+APDU latency histograms and status word counters in Prometheus text format.
+
+Every Card (see card.py) owns a Metrics object that only its own thread
+updates, so no locking is needed on the hot path; merge() folds the
+objects of several cards or worker processes together before export.
+Latencies go into log-linear buckets (four per power of two, i.e. a
+relative error below 19%) from 0.25 ms up to about 16 s.
+"""
+
+import contextlib
+import os
+
+from costmodel import INSTRUCTIONS
+
+# Status words, mirroring include/defs_apdu.h
+STATUS_WORDS = {
+  0x9000: 'ERR_OK',
+  0x6402: 'ERR_WRONGCLASS',
+  0x6D00: 'ERR_INS_NOT_SUPPORTED',
+  0x6A80: 'ERR_WRONGDATA',
+  0x6700: 'ERR_WRONGLENGTH',
+  0x6B00: 'ERR_WRONGP1P2',
+  0x6982: 'ERR_WRONGSIGNATURE',
+  0x6A84: 'ERR_NOT_ENOUGH_MEMORY',
+  0x6A88: 'ERR_DATA_NOT_FOUND',
+}
+
+SUB_BUCKETS = 4
+BOUNDS = [2.0 ** e * (1.0 + float(s) / SUB_BUCKETS) for e in range(-2, 14) for s in range(SUB_BUCKETS)]
+
+def instruction(ins):
+  if ins == 0xA4:
+    return 'SELECT'
+  return INSTRUCTIONS.get(ins, '%02X' % ins)
+
+def status(sw):
+  return STATUS_WORDS.get(sw, '%04X' % sw)
+
+class Histogram(object):
+  def __init__(self):
+    self.counts = [0] * (len(BOUNDS) + 1)
+    self.sum = 0.0
+    self.count = 0
+
+  def record(self, ms):
+    lo, hi = 0, len(BOUNDS)
+    while lo < hi:
+      mid = (lo + hi) // 2
+      if ms <= BOUNDS[mid]:
+        hi = mid
+      else:
+        lo = mid + 1
+    self.counts[lo] += 1
+    self.sum += ms
+    self.count += 1
+
+  def merge(self, other):
+    self.counts = [a + b for (a, b) in zip(self.counts, other.counts)]
+    self.sum += other.sum
+    self.count += other.count
+
+  def quantile(self, q):
+    """Upper bound of the bucket holding the q-quantile."""
+    rank, seen = q * self.count, 0
+    for (i, n) in enumerate(self.counts):
+      seen += n
+      if n and seen >= rank:
+        return BOUNDS[i] if i < len(BOUNDS) else float('inf')
+    return 0.0
+
+class Metrics(object):
+  def __init__(self):
+    self.latency = {}    # instruction -> Histogram
+    self.responses = {}  # (instruction, status) -> count
+    self.bytes = [0, 0]  # sent, received
+    self.sessions = [0, 0]  # issuances and presentations started, finished
+
+  def record(self, apdu, response, sw, ms):
+    ins = instruction(apdu[1])
+    self.latency.setdefault(ins, Histogram()).record(ms)
+    key = (ins, status(sw))
+    self.responses[key] = self.responses.get(key, 0) + 1
+    self.bytes[0] += len(apdu)
+    self.bytes[1] += len(response) + 2
+
+  def start_session(self):
+    self.sessions[0] += 1
+
+  def finish_session(self):
+    self.sessions[1] += 1
+
+  @contextlib.contextmanager
+  def session(self):
+    self.start_session()
+    try:
+      yield
+    finally:
+      self.finish_session()
+
+  def merge(self, other):
+    for (ins, histogram) in other.latency.items():
+      self.latency.setdefault(ins, Histogram()).merge(histogram)
+    for (key, n) in other.responses.items():
+      self.responses[key] = self.responses.get(key, 0) + n
+    self.bytes = [a + b for (a, b) in zip(self.bytes, other.bytes)]
+    self.sessions = [a + b for (a, b) in zip(self.sessions, other.sessions)]
+
+  def write_prometheus(self, out):
+    out.write('# HELP uprove_apdu_latency_ms Command/response round trip per instruction.\n')
+    out.write('# TYPE uprove_apdu_latency_ms histogram\n')
+    for ins in sorted(self.latency):
+      histogram, cumulative = self.latency[ins], 0
+      for (bound, n) in zip(BOUNDS + [float('inf')], histogram.counts):
+        cumulative += n
+        le = '+Inf' if bound == float('inf') else repr(bound)
+        out.write('uprove_apdu_latency_ms_bucket{ins="%s",le="%s"} %d\n' % (ins, le, cumulative))
+      out.write('uprove_apdu_latency_ms_sum{ins="%s"} %f\n' % (ins, histogram.sum))
+      out.write('uprove_apdu_latency_ms_count{ins="%s"} %d\n' % (ins, histogram.count))
+    out.write('# HELP uprove_apdu_responses_total Responses per instruction and status word.\n')
+    out.write('# TYPE uprove_apdu_responses_total counter\n')
+    for ((ins, sw), n) in sorted(self.responses.items()):
+      out.write('uprove_apdu_responses_total{ins="%s",sw="%s"} %d\n' % (ins, sw, n))
+    out.write('# HELP uprove_apdu_bytes_total APDU bytes by direction.\n')
+    out.write('# TYPE uprove_apdu_bytes_total counter\n')
+    out.write('uprove_apdu_bytes_total{direction="command"} %d\n' % self.bytes[0])
+    out.write('uprove_apdu_bytes_total{direction="response"} %d\n' % self.bytes[1])
+    out.write('# HELP uprove_sessions_started_total Issuances and presentations started.\n')
+    out.write('# TYPE uprove_sessions_started_total counter\n')
+    out.write('uprove_sessions_started_total %d\n' % self.sessions[0])
+    out.write('# HELP uprove_sessions_finished_total Issuances and presentations finished, successful or not.\n')
+    out.write('# TYPE uprove_sessions_finished_total counter\n')
+    out.write('uprove_sessions_finished_total %d\n' % self.sessions[1])
+
+  def export(self, path):
+    """Replace path atomically, as the node_exporter textfile collector expects."""
+    with open(path + '.tmp', 'w') as f:
+      self.write_prometheus(f)
+    os.rename(path + '.tmp', path)
+
+  def summary(self, out):
+    out.write('%-24s %8s %10s %10s %10s\n' % ('instruction', 'count', 'p50 ms', 'p99 ms', 'p99.9 ms'))
+    for ins in sorted(self.latency):
+      histogram = self.latency[ins]
+      out.write('%-24s %8d %10.2f %10.2f %10.2f\n' % (ins, histogram.count, histogram.quantile(0.5),
+                                                     histogram.quantile(0.99), histogram.quantile(0.999)))
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+#
+# scaling.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Sweep the number of attributes and report how the applet scales.
+
+For every n a simulator build with MAX_ATTR = n is made, personalised and
+run through one issuance and one presentation with the script from
+genparams.py.  The trace is charged against the cost model, and the memory
+taken by the attribute dependent tables is computed from their
+declarations in uprove.c.  The simulator command gets the .hzx file and
+the script; it must print the trace of the SIMULATOR build on stdout.
+
+  tools/scaling.py --simulator 'hsim -script {script} {hzx}' --platform ML2
+  tools/scaling.py --from 1 --to 8 --build '' --simulator './sim-{n} {script}'
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+import costmodel
+import genparams
+from uprove import *
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+# The APDUs whose cost depends on n: computeXt() and calcGamma(),
+# the precomputations, sigma_c' and challengeM() with generateChallengeC().
+COLUMNS = [0x0D, 0x11, 0x13, 0x14, 0x21]
+
+S_LENGTH = 31
+
+def attr_heap_size(n):
+  """ATTR_HEAP_SIZE from defs_sizes.h."""
+  return max(64 * n, 255)
+
+def temp_size(n):
+  """TEMP_SIZE from defs_sizes.h."""
+  encoded = 4 + 255 + 2 * (4 + PSIZE_BYTES) + (4 + QSIZE_BYTES) + \
+            4 + (n + 2) * (4 + PSIZE_BYTES) + 4 + n + 4 + S_LENGTH
+  return max(encoded, 2048)
+
+def temp_ram_size(n):
+  """TEMP_RAM_SIZE from defs_sizes.h."""
+  return max(4 + 4 * n + 4 + (4 + QSIZE_BYTES) * n, 256 + 72)
+
+TEMP_SPACE_SIZE = 321  # the TEMP_SPACE struct sharing temp_ram
+HASH_SPACE_SIZE = 28   # the HASH_SPACE struct sharing w_ram with w_i
+RAM_SIZE = 800         # the RAM uprove.c assumes
+
+def eeprom(n):
+  """g_i, z_i, x_i, attrHeap with its offsets and sizes, e_i, w_iTest and tempArray."""
+  return 2 * (n + 2) * (PSIZE_BYTES + 1) + 2 * (n + 1) * (QSIZE_BYTES + 1) + \
+         attr_heap_size(n) + 2 * n + n + 2 + n + temp_size(n)
+
+def ram(n):
+  """UD, w_ram, r_i, a, c, temp_ram, t and streamIndex."""
+  w_i = (n + 1) * (QSIZE_BYTES + 1)
+  return n + max(w_i, HASH_SPACE_SIZE) + w_i + 2 * (QSIZE_BYTES + 1) + \
+         max(temp_ram_size(n), TEMP_SPACE_SIZE) + PSIZE_BYTES + 1 + 1
+
+def measure(args, n, workdir):
+  script = os.path.join(workdir, 'script%d.txt' % n)
+  vectors = genparams.generate(read_vectors(args.base), n, [i for i in (2, 5) if i <= n])
+  with open(script, 'w') as f:
+    f.write(genparams.script(vectors, n) + '\n')
+  fields = {'n': n, 'script': script, 'hzx': os.path.join(ROOT, 'bin', str(n),
+                                                          'uprove.simulator-%s.hzx' % args.card)}
+  if args.build:
+    subprocess.check_call(args.build.format(**fields), shell=True, cwd=ROOT, stdout=sys.stderr)
+  trace = subprocess.check_output(args.simulator.format(**fields), shell=True, cwd=ROOT,
+                                  universal_newlines=True)
+  return costmodel.parse(trace.splitlines())
+
+def main():
+  parser = argparse.ArgumentParser(description='Report per-APDU cost and memory for n = 1..16 attributes.')
+  parser.add_argument('--simulator', required=True, help='command running {script} on {hzx} (also {n})')
+  parser.add_argument('--build', default='make simulator PLATFORM={card} MAX_ATTR={n} BINDIR=bin/{n}',
+                      help='command building the simulator for {n}, empty to skip')
+  parser.add_argument('--card', default='ML3', help='PLATFORM of the build')
+  parser.add_argument('--platform', default='ML3', choices=sorted(costmodel.PLATFORMS), help='cost table')
+  parser.add_argument('--base', default=os.path.join(ROOT, 'test', 'testvectors.txt'))
+  parser.add_argument('--from', dest='first', type=int, default=1)
+  parser.add_argument('--to', dest='last', type=int, default=16)
+  args = parser.parse_args()
+  args.build = args.build.replace('{card}', args.card)
+
+  table = costmodel.PLATFORMS[args.platform]
+  out = sys.stdout
+  out.write('# Platform %s, times in ms, memory in bytes\n' % args.platform)
+  out.write('%3s' % 'n' + ''.join('%24s' % costmodel.INSTRUCTIONS[ins] for ins in COLUMNS) +
+            '%14s%14s%8s%8s\n' % ('issuance', 'presentation', 'EEPROM', 'RAM'))
+  workdir = tempfile.mkdtemp(prefix='scaling')
+  for n in range(args.first, args.last + 1):
+    commands = measure(args, n, workdir)
+    cost = dict((ins, 0.0) for ins in COLUMNS)
+    totals = {}
+    for cmd in commands:
+      ms = cmd.cost(table)
+      if cmd.ins in cost:
+        cost[cmd.ins] += ms
+      totals[costmodel.phase(cmd.ins)] = totals.get(costmodel.phase(cmd.ins), 0.0) + ms
+    out.write('%3d' % n + ''.join('%24.1f' % cost[ins] for ins in COLUMNS) +
+              '%14.1f%14.1f%8d%8d%s\n' % (totals.get('issuance', 0.0), totals.get('presentation', 0.0),
+                                          eeprom(n), ram(n), ' *' if ram(n) > RAM_SIZE else ''))
+    out.flush()
+  if [n for n in range(args.first, args.last + 1) if ram(n) > RAM_SIZE]:
+    out.write('# * more RAM than the %d bytes uprove.c assumes\n' % RAM_SIZE)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# throughput.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+End-to-end issuance and presentation runs with real randomness.
+
+The card must be personalised with the issuer parameters and attributes
+from the vectors file (e.g. by running test/testscript.txt).  Test mode is
+switched off unless --test-mode is given, so alpha, beta1, beta2 and w_i
+are random; the issuer stand-in generates a fresh sigma_a/sigma_b/sigma_r
+for every token and every returned token and presentation proof is
+checked by the verifier.  --record captures the APDUs for apdutrace.py.
+With --host-verify the card skips its own check of the token signature
+(CMD_ISSUE_SIGMA_R P1=0), the exponentiations of which only involve
+public values, and relies on the host's check instead.  --chained
+fetches r_0 and the undisclosed r_i in one response.
+With --verify the collected proofs are verified again as one batch spread
+over all cores, which is the rate a verifier backend can sustain.  With
+--metrics the per-instruction latency histograms and status word counters
+are written in Prometheus text format while the run is going on.
+--host-issue runs the prover side of issuance on the host instead of a
+card, for that many tokens spread over all cores (BatchProver in
+uprove.py), and checks every token.
+
+  tools/throughput.py --vectors test/testvectors.txt -n 20
+  tools/throughput.py --command './simulator' --disclose 2,5
+  tools/throughput.py --verify 10000
+  tools/throughput.py -n 100000 --metrics /var/lib/node_exporter/uprove.prom
+  tools/throughput.py --test-mode --record session.uptr
+  tools/throughput.py --host-issue 10000 --processes 8
+"""
+
+import argparse
+import os
+import sys
+import time
+
+from apdutrace import Recorder
+from card import *
+from uprove import *
+
+def issue(card, params, issuer, verifier, card_verifies=True):
+  card.send(CMD_ISSUE_PRECOMPUTE)
+  sigma_z, sigma_a, sigma_b = issuer.first_message()
+  card.send(CMD_ISSUE_SIGMA_A, data=params.p_bytes(sigma_a))
+  sigma_c = to_int(card.send(CMD_ISSUE_SIGMA_B, data=params.p_bytes(sigma_b)))
+  sigma_r = issuer.third_message(sigma_c)
+  # P1 = 1: the card verifies the signature on the token as well, P1 = 0
+  # leaves that to the verify_token() below and saves the card four ModExps
+  card.send(CMD_ISSUE_SIGMA_R, 0x01 if card_verifies else 0x00, data=to_bytes(sigma_r, QSIZE_BYTES))
+  return verifier.verify_token(read_token(card))
+
+def read_token(card):
+  sigmas = [to_int(card.send(CMD_PRESENT_RETURN_SIGMAS, i, 4)) for i in range(4)]
+  return Token(*sigmas)
+
+def present(card, params, verifier, disclosed, proofs, chained=False):
+  m = os.urandom(QSIZE_BYTES)
+  card.send(CMD_PRESENT_SELECT_D, data=bytes(disclosed))
+  a = to_int(card.send(CMD_PRESENT_CHALLENGE_M, data=m))
+  attributes = {}
+  for i in disclosed:
+    attributes[i] = card.send(CMD_PRESENT_DISCLOSE_AI, i, params.n)
+  indices = [0] + [i for i in range(1, params.n + 1) if i not in disclosed]
+  if chained:
+    response = card.send(CMD_PRESENT_RETURN_RI, RETURN_RI_ALL, params.n + 1)
+    r = dict((i, to_int(response[k * QSIZE_BYTES:(k + 1) * QSIZE_BYTES])) for (k, i) in enumerate(indices))
+  else:
+    r = dict((i, to_int(card.send(CMD_PRESENT_RETURN_RI, i, params.n + 1))) for i in indices)
+  proof = (read_token(card), m, a, r, attributes)
+  proofs.append(proof)
+  return verifier.verify_proof(*proof)
+
+def host_issue(params, issuer, verifier, pi, x, count, processes):
+  first_messages = issuer.first_messages(count)
+  with BatchProver(params, issuer.gamma, issuer.sigma_z, pi, x, processes) as prover:
+    start = time.perf_counter()
+    sigma_cs = prover.second_messages(first_messages)
+    tokens = prover.tokens(issuer.third_messages(sigma_cs))
+    elapsed = time.perf_counter() - start
+  rejected = len([token for token in tokens if not verifier.verify_token(token.token)])
+  print('%-13s %5d runs %8.3f s %8.2f /s %d rejected' %
+        ('host issuance', count, elapsed, count / elapsed if elapsed else 0.0, rejected))
+  return rejected
+
+def run(label, count, step, card, args):
+  failures = 0
+  start = exported = time.perf_counter()
+  for _ in range(count):
+    try:
+      with card.metrics.session():
+        if not step():
+          failures += 1
+    except CardError as e:
+      print(e)
+      failures += 1
+    if args.metrics and time.perf_counter() - exported >= args.interval:
+      card.metrics.export(args.metrics)
+      exported = time.perf_counter()
+  elapsed = time.perf_counter() - start
+  print('%-13s %5d runs %8.3f s %8.2f /s %d rejected' %
+        (label, count, elapsed, count / elapsed if elapsed else 0.0, failures))
+  return failures
+
+def main():
+  parser = argparse.ArgumentParser(description='Measure end-to-end issuances/sec and presentations/sec.')
+  parser.add_argument('--vectors', default=os.path.join(os.path.dirname(__file__), '..', 'test', 'testvectors.txt'))
+  parser.add_argument('--reader', type=int, default=0, help='PC/SC reader index')
+  parser.add_argument('--command', help='simulator command speaking hex APDUs on stdin/stdout')
+  parser.add_argument('-n', '--count', type=int, default=10)
+  parser.add_argument('--verify', type=int, default=0, help='batch verify this many of the collected proofs')
+  parser.add_argument('--processes', type=int, help='verifier and host prover processes (default: all cores)')
+  parser.add_argument('--host-issue', type=int, default=0, help='issue this many tokens on the host, no card')
+  parser.add_argument('--metrics', help='Prometheus text file, rewritten every --interval seconds')
+  parser.add_argument('--interval', type=float, default=10.0)
+  parser.add_argument('--latency', action='store_true', help='print per-instruction latency percentiles')
+  parser.add_argument('--host-verify', action='store_true',
+                      help='let the host check the token signature instead of the card')
+  parser.add_argument('--chained', action='store_true', help='fetch all r_i with one CMD_PRESENT_RETURN_RI')
+  parser.add_argument('--record', help='record the session into this APDU trace (see apdutrace.py)')
+  parser.add_argument('--test-mode', action='store_true',
+                      help='keep the fixed test randomness so that the recorded trace replays byte for byte')
+  parser.add_argument('--disclose', default='2,5', help='comma separated indices of disclosed attributes')
+  args = parser.parse_args()
+
+  vectors = read_vectors(args.vectors)
+  params = IssuerParameters.from_vectors(vectors)
+  ti, pi = bytes.fromhex(vectors['TI']), bytes.fromhex(vectors['PI'])
+  x = [params.x_i(bytes.fromhex(vectors['A%d' % i]), i) for i in range(1, params.n + 1)]
+  issuer = Issuer(params, int(vectors['y0'], 16), ti, x)
+  verifier = Verifier(params, ti, pi)
+  disclosed = [int(i) for i in args.disclose.split(',') if i]
+  if args.host_issue:
+    return 1 if host_issue(params, issuer, verifier, pi, x, args.host_issue, args.processes) else 0
+
+  recorder = Recorder(args.record) if args.record else None
+  card = connect(args.reader, args.command, recorder)
+  card.send(CMD_TEST, 0x01 if args.test_mode else 0x00)
+  card.send(CMD_INIT_PRECOMPUTE_INPUTS)
+
+  failures = run('issuance', args.count, lambda: issue(card, params, issuer, verifier, not args.host_verify),
+                 card, args)
+  proofs = []
+  failures += run('presentation', args.count,
+                  lambda: present(card, params, verifier, disclosed, proofs, args.chained), card, args)
+  if args.metrics:
+    card.metrics.export(args.metrics)
+  if args.latency:
+    card.metrics.summary(sys.stdout)
+
+  if args.verify and proofs:
+    batch = (proofs * (args.verify // len(proofs) + 1))[:args.verify]
+    start = time.perf_counter()
+    results = verify_batch(params, ti, pi, batch, args.processes)
+    elapsed = time.perf_counter() - start
+    print('%-13s %5d runs %8.3f s %8.2f /s %d rejected' %
+          ('verification', len(batch), elapsed, len(batch) / elapsed, results.count(False)))
+    failures += results.count(False)
+  if recorder:
+    recorder.close()
+  return 1 if failures else 0
+
+if __name__ == '__main__':
+  sys.exit(main())
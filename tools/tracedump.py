@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# tracedump.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Decode a simulator trace into a readable dump, a Chrome trace or folded
+stacks for flamegraph.pl.
+
+The card has no clock, so the timeline is built from the cost model: every
+primitive advances the time by its estimated cost on the chosen platform,
+[FUN] lines open and close nested slices, and the APDU overhead (I/O and
+EEPROM writes) closes each command.  Intermediate values of a TRACE=2
+build show up as instant events carrying the value.
+
+  tools/tracedump.py simulator.log
+  tools/tracedump.py --chrome trace.json --platform ML2 simulator.log
+  tools/tracedump.py --folded - simulator.log | flamegraph.pl > apdus.svg
+"""
+
+import argparse
+import json
+import sys
+
+import costmodel
+
+class Slice(object):
+  def __init__(self, name, start, depth):
+    self.name, self.start, self.depth = name, start, depth
+    self.end = start
+    self.children = []
+    self.values = []
+
+def build(stream, table):
+  """Turn the trace into a list of command slices with nested children."""
+  commands = []
+  stack = []
+  now = 0.0
+  command = None
+
+  def close_command():
+    if command is not None:
+      slice = stack[0]
+      overhead = command.cost(table) - sum(costmodel.primitive_cost(table, *p) for p in command.primitives)
+      io = Slice('I/O and EEPROM', now, 1)
+      io.end = now + overhead
+      slice.children.append(io)
+      slice.end = io.end
+      return slice.end
+    return now
+
+  for line in stream:
+    line = line.rstrip('\r\n')
+    fields = line.split()
+    if len(fields) == 5 and fields[0] == '[CMD]':
+      now = close_command()
+      command = costmodel.command(fields, command)
+      stack = [Slice('%s P1=%s P2=%s' % (command.name(), fields[2], fields[3]), now, 0)]
+      commands.append(stack[0])
+    elif command is None:
+      continue
+    elif len(fields) == 4 and fields[0] == '[PRM]':
+      primitive = (fields[1], int(fields[2]), int(fields[3]))
+      command.primitives.append(primitive)
+      slice = Slice('%s %s %s' % primitive, now, len(stack))
+      now += costmodel.primitive_cost(table, *primitive)
+      slice.end = now
+      stack[-1].children.append(slice)
+    elif len(fields) == 3 and fields[0] == '[FUN]':
+      if fields[1] == '>':
+        slice = Slice(fields[2], now, len(stack))
+        stack[-1].children.append(slice)
+        stack.append(slice)
+      elif len(stack) > 1 and stack[-1].name == fields[2]:
+        stack.pop().end = now
+    elif ': ' in line and not line.startswith('['):
+      (label, value) = line.split(': ', 1)
+      stack[-1].values.append((now, label, value))
+  close_command()
+  return commands
+
+def walk(slice, path):
+  yield (slice, path)
+  for child in slice.children:
+    for item in walk(child, path + [child.name]):
+      yield item
+
+def dump_slice(slice, out, width):
+  out.write('%s%-*s %10.2f ms\n' % ('  ' * slice.depth, 48 - 2 * slice.depth, slice.name,
+                                    slice.end - slice.start))
+  indent = '  ' * (slice.depth + 1)
+  items = [(child.start, 0, child) for child in slice.children] + [(value[0], 1, value) for value in slice.values]
+  for (_, kind, item) in sorted(items, key=lambda item: item[:2]):
+    if kind == 0:
+      dump_slice(item, out, width)
+      continue
+    (_, label, value) = item
+    out.write('%s%s: %s\n' % (indent, label, value[:width]))
+    for i in range(width, len(value), width):
+      out.write('%s%s  %s\n' % (indent, ' ' * len(label), value[i:i + width]))
+
+def dump(commands, out, width):
+  for command in commands:
+    dump_slice(command, out, width)
+
+def chrome(commands, out):
+  """Trace Event Format, loadable in chrome://tracing and Perfetto."""
+  events = []
+  for command in commands:
+    for (slice, _) in walk(command, []):
+      events.append({'name': slice.name, 'ph': 'X', 'pid': 1, 'tid': 1,
+                     'ts': slice.start * 1000.0, 'dur': (slice.end - slice.start) * 1000.0})
+      for (ts, label, value) in slice.values:
+        events.append({'name': label, 'ph': 'i', 's': 't', 'pid': 1, 'tid': 1,
+                       'ts': ts * 1000.0, 'args': {'value': value}})
+  json.dump({'traceEvents': events, 'displayTimeUnit': 'ms'}, out)
+
+def folded(commands, out):
+  """Self time per stack in microseconds, the input of flamegraph.pl."""
+  stacks = {}
+  for command in commands:
+    for (slice, path) in walk(command, [command.name.split()[0]]):
+      own = (slice.end - slice.start) - sum(c.end - c.start for c in slice.children)
+      key = ';'.join(name.replace(' ', '_') for name in path)
+      stacks[key] = stacks.get(key, 0.0) + own
+  for (key, us) in sorted(stacks.items()):
+    if us > 0:
+      out.write('%s %d\n' % (key, round(us * 1000.0)))
+
+def main():
+  parser = argparse.ArgumentParser(description='Decode a simulator trace.')
+  parser.add_argument('trace', nargs='?', type=argparse.FileType('r'), default=sys.stdin)
+  parser.add_argument('--platform', default='ML3', choices=sorted(costmodel.PLATFORMS))
+  parser.add_argument('--chrome', type=argparse.FileType('w'), help='write a Chrome trace here')
+  parser.add_argument('--folded', type=argparse.FileType('w'), help='write folded stacks here')
+  parser.add_argument('--width', type=int, default=64, help='hex digits per value line')
+  args = parser.parse_args()
+
+  commands = build(args.trace, costmodel.PLATFORMS[args.platform])
+  if args.chrome:
+    chrome(commands, args.chrome)
+  if args.folded:
+    folded(commands, args.folded)
+  if not args.chrome and not args.folded:
+    dump(commands, sys.stdout, args.width)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,493 @@
+#
+# uprove.py
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Host-side counterparts of the prover in src/uprove.c: an issuer stand-in
+that holds y0, the prover's precomputations for many tokens at once and a
+verifier for tokens and presentation proofs.
+
+All hashing follows the byte layout produced by putNumberIntoArray() and
+friends on the card, so the values computed here can be compared directly
+with the card output and with test/testvectors.txt.
+"""
+
+import hashlib
+import random
+
+PSIZE_BYTES = 128
+QSIZE_BYTES = 20
+
+_random = random.SystemRandom()
+
+# Groups the applet is built with, by the identifier that CMD_INIT_SET_PQG
+# and CMD_INIT_GET_PQG P1=3 use; GROUP_CUSTOM means p, q or g were set
+GROUP_CUSTOM = 0x00
+GROUPS = {
+  0x01: (  # the 1024-bit group of the U-Prove test vectors
+    int(
+      'd21ae8d66e6c6b3ced0eb3df1a26c91bdeed013c17d849d30ec309813e4d3799f26db0d494e82ec61ea9fdc70bb5cbca'
+      'f2e5f18a836494f58e67c6d616480c37a7f2306101fc9f0f4768f9c9793c2be176b0b7c979b4065d3e835686a3f0b842'
+      '0c6834cb17930386dedab2b07dd473449a48baab316286b421052475d134cd3b', 16),
+    int('fff80ae19daebc61f46356af0935dc0e81148eb1', 16),
+    int(
+      'abcec972e9a9dd8d133270cfeac26f726e567d964757630d6bd43460d0923a46aec0ace255ebf3ddd4b1c4264f53e68b'
+      '361afb777a13cf0067dae364a34d55a0965a6cccf78852782923813cf8708834d91f6557d783ec75b5f37cd9185f027b'
+      '042c1c72e121b1266a408be0bb7270d65917b69083633e1f3cd60624612fc8c1', 16)),
+}
+
+def group_of(p, q, g):
+  """Identifier of the built-in group (p, q, g), or GROUP_CUSTOM."""
+  for (identifier, pqg) in GROUPS.items():
+    if pqg == (p, q, g):
+      return identifier
+  return GROUP_CUSTOM
+
+def to_int(data):
+  return int.from_bytes(data, 'big')
+
+def to_bytes(value, length):
+  return value.to_bytes(length, 'big')
+
+def put_int(value):
+  """putIntIntoArray()"""
+  return to_bytes(value, 4)
+
+def put_number(data):
+  """putNumberIntoArray(): P and Q sized numbers lose their leading zeros."""
+  if len(data) in (PSIZE_BYTES, QSIZE_BYTES):
+    data = data.lstrip(b'\0')
+  return put_int(len(data)) + data
+
+def sha1(data):
+  return hashlib.sha1(data).digest()
+
+def read_vectors(path):
+  """Read a 'name: hex' file such as test/testvectors.txt."""
+  vectors = {}
+  with open(path) as f:
+    for line in f:
+      if ':' in line:
+        name, value = line.split(':', 1)
+        vectors[name.strip()] = value.strip()
+  return vectors
+
+class IssuerParameters(object):
+  """UID_p, p, q, g, g_0..g_n, g_t, e_i and S as personalised on the card."""
+
+  def __init__(self, uid_p, p, q, g, g_i, e_i, spec):
+    self.uid_p, self.p, self.q, self.g = uid_p, p, q, g
+    self.g_i = g_i
+    self.e_i = e_i
+    self.spec = spec
+    self.n = len(e_i)
+
+  @classmethod
+  def from_vectors(cls, vectors):
+    n = len([k for k in vectors if k[:1] == 'A' and k[1:].isdigit()])
+    g_i = [int(vectors['g%d' % i], 16) for i in range(n + 1)] + [int(vectors['gt'], 16)]
+    e_i = [int(vectors['e%d' % i]) for i in range(1, n + 1)]
+    return cls(bytes.fromhex(vectors['UIDp']), int(vectors['p'], 16), int(vectors['q'], 16),
+               int(vectors['g'], 16), g_i, e_i, bytes.fromhex(vectors['S']))
+
+  def p_bytes(self, value):
+    return to_bytes(value, PSIZE_BYTES)
+
+  def digest(self):
+    """P, as hashed by computeXt()."""
+    data = put_number(self.uid_p)
+    data += put_number(self.p_bytes(self.p))
+    data += put_number(to_bytes(self.q, QSIZE_BYTES))
+    data += put_number(self.p_bytes(self.g))
+    data += put_int(len(self.g_i))
+    for g in self.g_i:
+      data += put_number(self.p_bytes(g))
+    data += put_int(self.n) + bytes(self.e_i)
+    data += put_number(self.spec)
+    return sha1(data)
+
+  def x_t(self, ti):
+    data = b'\x01' + put_number(self.digest()) + put_number(ti)
+    return to_int(sha1(data)) % self.q
+
+  def x_i(self, attribute, index):
+    """Attribute value as set by CMD_INIT_SET_RAWATTRVAL (index from 1)."""
+    if self.e_i[index - 1]:
+      return to_int(sha1(put_number(attribute)))
+    return to_int(attribute)
+
+  def gamma(self, x, x_t):
+    """
+    g_0 g_1^x_1 ... g_n^x_n g_t^x_t mod p, as in calcGamma(); the n + 1
+    exponentiations share their squarings in one multi_exp().
+    """
+    return multi_exp([(self.g_i[0], 1)] + list(zip(self.g_i[1:], list(x) + [x_t])), self.p)
+
+  def z_i(self, y0):
+    return [pow(g, y0, self.p) for g in self.g_i]
+
+class Token(object):
+  """The values returned by CMD_PRESENT_RETURN_SIGMAS."""
+
+  def __init__(self, h, sigma_z, sigma_c, sigma_r):
+    self.h, self.sigma_z, self.sigma_c, self.sigma_r = h, sigma_z, sigma_c, sigma_r
+
+  def uid(self, params):
+    """UID_t, as hashed by computeTokenID()."""
+    data = put_number(params.p_bytes(self.h))
+    data += put_number(params.p_bytes(self.sigma_z))
+    data += put_number(to_bytes(self.sigma_c, QSIZE_BYTES))
+    data += put_number(to_bytes(self.sigma_r, QSIZE_BYTES))
+    return to_int(sha1(data)) % params.q
+
+class ProverToken(object):
+  """
+  A token as the prover keeps it: the Token and the private values a
+  presentation needs, alpha^-1 and the attribute values x_1..x_n, like
+  the card keeps alphaInverse and x_i after CMD_ISSUE_SIGMA_R.
+  """
+
+  def __init__(self, token, alpha_inverse, x):
+    self.token, self.alpha_inverse, self.x = token, alpha_inverse, x
+
+  def present(self, params, m, disclosed, w=None):
+    """
+    (a, r) for message m, disclosing the indices (from 1) in disclosed, as
+    CMD_PRESENT_CHALLENGE_M and CMD_PRESENT_RETURN_RI compute them; r maps
+    0 and every undisclosed index to r_i.  w maps the same indices to the
+    w_i, fresh random values unless given.
+    """
+    p, q = params.p, params.q
+    undisclosed = [i for i in range(1, params.n + 1) if i not in disclosed]
+    if w is None:
+      w = dict((i, _random.randrange(q)) for i in [0] + undisclosed)
+    t = multi_exp([(self.token.h, w[0])] + [(params.g_i[i], w[i]) for i in undisclosed], p)
+    a = to_int(sha1(put_number(params.p_bytes(t)))) % q
+    c = challenge_c(params, self.token.uid(params), a, m, sorted(disclosed), self.x)
+    r = {0: (c * self.alpha_inverse + w[0]) % q}
+    for i in undisclosed:
+      r[i] = (w[i] - c * self.x[i - 1]) % q
+    return a, r
+
+def sigma_c_midstate(params, h, pi, sigma_z):
+  """
+  SHA-1 over the part of the sigma_c' input that is fixed before the
+  issuer's first message, like the state doPrecomputations() keeps.
+  """
+  return hashlib.sha1(put_number(params.p_bytes(h)) + put_number(pi) + put_number(params.p_bytes(sigma_z)))
+
+def finish_sigma_c(params, midstate, sigma_a, sigma_b):
+  """sigma_c', as finished by sigmaBCommittment(); midstate is not changed."""
+  state = midstate.copy()
+  state.update(put_number(params.p_bytes(sigma_a)) + put_number(params.p_bytes(sigma_b)))
+  return to_int(state.digest()) % params.q
+
+def batch_inverse(values, q):
+  """
+  Inverses mod q of non-zero values with one Fermat exponentiation and
+  3(k - 1) multiplications (Montgomery's trick).
+  """
+  prefix, product = [], 1
+  for v in values:
+    product = product * v % q
+    prefix.append(product)
+  inverse = pow(product, q - 2, q)
+  result = [0] * len(values)
+  for i in reversed(range(len(values))):
+    result[i] = inverse * prefix[i - 1] % q if i else inverse
+    inverse = inverse * values[i] % q
+  return result
+
+class Bases(object):
+  """Fixed-base tables for gamma, sigma_z, g_0 and g, the same for every token of an issuer."""
+
+  def __init__(self, params, gamma, sigma_z):
+    self.gamma = FixedBase(gamma, params.p)
+    self.sigma_z = FixedBase(sigma_z, params.p)
+    self.g_0 = FixedBase(params.g_i[0], params.p)
+    self.g = FixedBase(params.g, params.p)
+
+class Precomputation(object):
+  """What doPrecomputations() leaves on the card for one token."""
+
+  def __init__(self, params, bases, pi, alpha, alpha_inverse, beta1, beta2):
+    p, q = params.p, params.q
+    self.alpha, self.alpha_inverse, self.beta1, self.beta2 = alpha, alpha_inverse, beta1, beta2
+    self.h = fixed_multi_exp([(bases.gamma, alpha)], p)
+    self.sigma_z = fixed_multi_exp([(bases.sigma_z, alpha)], p)
+    self.t_a = fixed_multi_exp([(bases.g_0, beta1), (bases.g, beta2)], p)
+    # sigma_z'^beta1 h^beta2 with the exponents moved onto the fixed bases
+    self.t_b = fixed_multi_exp([(bases.sigma_z, alpha * beta1 % q), (bases.gamma, alpha * beta2 % q)], p)
+    self.midstate = sigma_c_midstate(params, self.h, pi, self.sigma_z)
+
+def precompute_batch(params, bases, pi, k, rng=_random):
+  """
+  doPrecomputations() for k tokens at once; the k alpha^-1 mod q share a
+  single inversion through batch_inverse().
+  """
+  q = params.q
+  alphas = [rng.randrange(1, q) for _ in range(k)]
+  return [Precomputation(params, bases, pi, alpha, alpha_inverse, rng.randrange(q), rng.randrange(q))
+          for (alpha, alpha_inverse) in zip(alphas, batch_inverse(alphas, q))]
+
+def challenge_c(params, uid_t, a, m, disclosed, x):
+  """c, as hashed by generateChallengeC(); disclosed holds indices from 1."""
+  data = put_int(len(disclosed))
+  for i in disclosed:
+    data += put_int(i)
+  data += put_int(params.n)
+  for i in range(1, params.n + 1):
+    if i in disclosed:
+      data += put_number(to_bytes(x[i - 1], QSIZE_BYTES))
+    else:
+      data += put_int(0)
+  f = sha1(data)
+  data = put_number(to_bytes(uid_t, QSIZE_BYTES))
+  data += put_number(to_bytes(a, QSIZE_BYTES))
+  data += put_number(m)
+  data += put_number(f)
+  return to_int(sha1(data)) % params.q
+
+class Issuer(object):
+  """Issuer stand-in holding the private key y0."""
+
+  def __init__(self, params, y0, ti, x):
+    self.params = params
+    self.y0 = y0
+    self.gamma = params.gamma(x, params.x_t(ti))
+    self.sigma_z = pow(self.gamma, y0, params.p)  # the same for every token
+    # g and gamma are raised to a fresh w for every token
+    self.g_table = FixedBase(params.g, params.p)
+    self.gamma_table = FixedBase(self.gamma, params.p)
+    self.w = None
+    self.ws = None
+
+  def first_message(self):
+    """sigma_z and fresh sigma_a and sigma_b for CMD_ISSUE_SIGMA_A/B."""
+    params = self.params
+    self.w = _random.randrange(1, params.q)
+    return (self.sigma_z, fixed_multi_exp([(self.g_table, self.w)], params.p),
+            fixed_multi_exp([(self.gamma_table, self.w)], params.p))
+
+  def third_message(self, sigma_c):
+    """sigma_r for CMD_ISSUE_SIGMA_R."""
+    sigma_r = (sigma_c * self.y0 + self.w) % self.params.q
+    self.w = None
+    return sigma_r
+
+  def first_messages(self, k):
+    """(sigma_a, sigma_b) for k tokens, answered by third_messages()."""
+    p = self.params.p
+    self.ws = [_random.randrange(1, self.params.q) for _ in range(k)]
+    return [(fixed_multi_exp([(self.g_table, w)], p), fixed_multi_exp([(self.gamma_table, w)], p))
+            for w in self.ws]
+
+  def third_messages(self, sigma_cs):
+    q = self.params.q
+    sigma_rs = [(c * self.y0 + w) % q for (c, w) in zip(sigma_cs, self.ws)]
+    self.ws = None
+    return sigma_rs
+
+class FixedBase(object):
+  """
+  Window table for a base that is raised to many Q sized exponents:
+  row j holds base^(d * 2^(width * j)) for every digit d, so an
+  exponentiation costs one multiplication per non-zero digit.
+  """
+
+  def __init__(self, base, p, bits=QSIZE_BYTES * 8, width=8):
+    self.p, self.width = p, width
+    self.rows = []
+    for _ in range((bits + width - 1) // width):
+      row, x = [1], 1
+      for _ in range(1, 1 << width):
+        x = x * base % p
+        row.append(x)
+      self.rows.append(row)
+      base = x * base % p
+
+def fixed_multi_exp(pairs, p):
+  """Product of base^e over (FixedBase, e) pairs, exponents below 2^bits."""
+  result = 1
+  for (table, e) in pairs:
+    mask, rows = (1 << table.width) - 1, table.rows
+    j = 0
+    while e:
+      d = e & mask
+      if d:
+        result = result * rows[j][d] % p
+      e >>= table.width
+      j += 1
+  return result
+
+def multi_exp(pairs, p, width=4):
+  """Product of base^e over (base, e) pairs sharing the squarings (Straus)."""
+  mask = (1 << width) - 1
+  rows = []
+  for (base, e) in pairs:
+    row, x = [1], 1
+    for _ in range(1, 1 << width):
+      x = x * base % p
+      row.append(x)
+    rows.append(row)
+  result = 1
+  for j in reversed(range(0, max(e.bit_length() for (_, e) in pairs), width)):
+    if result != 1:
+      for _ in range(width):
+        result = result * result % p
+    for (row, (_, e)) in zip(rows, pairs):
+      d = (e >> j) & mask
+      if d:
+        result = result * row[d] % p
+  return result
+
+class Verifier(object):
+  """
+  Checks tokens and presentation proofs built from CMD_PRESENT_* output.
+  g and g_0..g_n, g_t get fixed-base tables when the verifier is created;
+  only h and sigma_z' are exponentiated from scratch for each proof.
+  """
+
+  def __init__(self, params, ti, pi):
+    self.params = params
+    self.ti, self.pi = ti, pi
+    self.x_t = params.x_t(ti)
+    self.g = FixedBase(params.g, params.p)
+    self.g_i = [FixedBase(g, params.p) for g in params.g_i]
+
+  def verify_token(self, token):
+    params = self.params
+    p, q = params.p, params.q
+    # out of range values would also break the fixed-base tables
+    if not (1 < token.h < p and 0 < token.sigma_z < p):
+      return False
+    if not (0 <= token.sigma_c < q and 0 <= token.sigma_r < q):
+      return False
+    inverse_c = q - token.sigma_c
+    sigma_a = fixed_multi_exp([(self.g, token.sigma_r), (self.g_i[0], inverse_c)], p)
+    sigma_b = multi_exp([(token.h, token.sigma_r), (token.sigma_z, inverse_c)], p)
+    midstate = sigma_c_midstate(params, token.h, self.pi, token.sigma_z)
+    return finish_sigma_c(params, midstate, sigma_a, sigma_b) == token.sigma_c
+
+  def verify_proof(self, token, m, a, r, attributes):
+    """
+    attributes maps each disclosed index (from 1) to its raw value and r
+    maps 0 and every undisclosed index to the returned r_i.  The token
+    signature is checked as well.  Missing or out of range responses
+    make the proof fail.
+    """
+    params = self.params
+    p, q = params.p, params.q
+    if not self.verify_token(token):
+      return False
+    if any(not 1 <= i <= params.n for i in attributes):
+      return False
+    for i in [0] + [i for i in range(1, params.n + 1) if i not in attributes]:
+      if i not in r or not 0 <= r[i] < q:
+        return False
+    x = [0] * params.n
+    disclosed = sorted(attributes)
+    for i in disclosed:
+      x[i - 1] = params.x_i(attributes[i], i)
+    c = challenge_c(params, token.uid(params), a, m, disclosed, x)
+    # (g_0 g_t^x_t prod_D g_i^x_i)^-c folded into the fixed-base exponents
+    inverse_c = q - c
+    pairs = [(self.g_i[0], inverse_c), (self.g_i[-1], self.x_t * inverse_c % q)]
+    for i in range(1, params.n + 1):
+      if i in attributes:
+        pairs.append((self.g_i[i], x[i - 1] * inverse_c % q))
+      else:
+        pairs.append((self.g_i[i], r[i]))
+    t = pow(token.h, r[0], p) * fixed_multi_exp(pairs, p) % p
+    return to_int(sha1(put_number(params.p_bytes(t)))) % q == a
+
+_verifier = None
+
+def _init_worker(params, ti, pi):
+  global _verifier
+  _verifier = Verifier(params, ti, pi)
+
+def _verify_one(proof):
+  return _verifier.verify_proof(*proof)
+
+def verify_batch(params, ti, pi, proofs, processes=None):
+  """
+  Verify (token, m, a, r, attributes) tuples on all cores; each worker
+  builds its own tables once.  Returns one bool per proof, in order.
+  """
+  import multiprocessing
+  with multiprocessing.Pool(processes, _init_worker, (params, ti, pi)) as pool:
+    chunk = max(1, len(proofs) // (4 * (processes or multiprocessing.cpu_count())))
+    return pool.map(_verify_one, proofs, chunk)
+
+_prover = None
+
+def _init_prover(params, gamma, sigma_z, pi):
+  global _prover
+  _prover = (params, Bases(params, gamma, sigma_z), pi)
+
+def _prove_chunk(first_messages):
+  """doPrecomputations() and sigma_c' for a chunk of (sigma_a, sigma_b)."""
+  (params, bases, pi) = _prover
+  p = params.p
+  states = []
+  for (pre, (sigma_a, sigma_b)) in zip(precompute_batch(params, bases, pi, len(first_messages)), first_messages):
+    sigma_a_prime = pre.t_a * sigma_a % p
+    sigma_b_prime = pre.t_b * pow(sigma_b, pre.alpha, p) % p
+    sigma_c_prime = finish_sigma_c(params, pre.midstate, sigma_a_prime, sigma_b_prime)
+    states.append((pre.h, pre.sigma_z, sigma_c_prime, pre.alpha_inverse, pre.beta1, pre.beta2))
+  return states
+
+class BatchProver(object):
+  """
+  The prover side of issuance for many tokens of one issuer on all cores.
+  second_messages() does the work of CMD_ISSUE_PRECOMPUTE, _SIGMA_A and
+  _SIGMA_B for a list of issuer first messages; tokens() finishes them
+  with the issuer's sigma_r like CMD_ISSUE_SIGMA_R P1=0, into ProverTokens
+  that keep alpha^-1 and x, the attribute values x_1..x_n gamma was
+  computed from, for the presentation.  Each worker builds the fixed-base
+  tables once; idle workers pick up the next chunk and the results come
+  back in input order.
+  """
+
+  def __init__(self, params, gamma, sigma_z, pi, x, processes=None, chunk=32):
+    import multiprocessing
+    self.params, self.x, self.chunk = params, x, chunk
+    self.pool = multiprocessing.Pool(processes, _init_prover, (params, gamma, sigma_z, pi))
+    self.states = None
+
+  def second_messages(self, first_messages):
+    """sigma_c for each (sigma_a, sigma_b)."""
+    chunks = [first_messages[i:i + self.chunk] for i in range(0, len(first_messages), self.chunk)]
+    self.states = [state for states in self.pool.imap(_prove_chunk, chunks) for state in states]
+    return [(sigma_c_prime + beta1) % self.params.q for (_, _, sigma_c_prime, _, beta1, _) in self.states]
+
+  def tokens(self, sigma_rs):
+    """The ProverTokens, given sigma_r for each sigma_c in order."""
+    q = self.params.q
+    tokens = [ProverToken(Token(h, sigma_z, sigma_c_prime, (sigma_r + beta2) % q), alpha_inverse, self.x)
+              for ((h, sigma_z, sigma_c_prime, alpha_inverse, _, beta2), sigma_r) in zip(self.states, sigma_rs)]
+    self.states = None
+    return tokens
+
+  def close(self):
+    self.pool.close()
+    self.pool.join()
+
+  def __enter__(self):
+    return self
+
+  def __exit__(self, *exc):
+    self.close()